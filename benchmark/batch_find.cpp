@@ -0,0 +1,87 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BST.h"
+
+// Throughput of find() called in a loop against find_batch(), and of insert() called in a loop
+// against insert_batch(), on trees larger than the cache, with random keys. Half of the looked up
+// keys are present.
+//
+// usage: ./batch_find.x [number of keys] [number of lookups]
+
+using clock_type = std::chrono::steady_clock;
+using PairType = std::pair<const int, int>;
+
+/**
+ * @brief Run f and return the elapsed time in nanoseconds.
+ */
+template <typename Function> double time_ns(Function&& f){
+    const auto start = clock_type::now();
+    f();
+    const auto stop = clock_type::now();
+    return std::chrono::duration<double, std::nano>(stop - start).count();
+}
+
+/**
+ * @brief Measure lookups and insertions, one at a time and batched, on a tree, and print the
+ * throughput in ns per operation.
+ */
+template <typename Tree>
+void run(const std::string& name, const std::vector<PairType>& pairs, const std::vector<int>& lookups){
+    Tree looped, batched;
+    const auto insert = time_ns([&]{
+        for(const auto& pair: pairs)
+            looped.insert(pair);
+    });
+    const auto insert_batch = time_ns([&]{ batched.insert_batch(pairs.begin(), pairs.end()); });
+
+    std::size_t found = 0, found_batch = 0;
+    const auto find = time_ns([&]{
+        for(const auto key: lookups)
+            found += looped.find(key) != looped.end();
+    });
+    std::vector<decltype(batched.begin())> results(lookups.size());
+    const auto find_batch = time_ns([&]{
+        batched.find_batch(lookups.begin(), lookups.end(), results.begin());
+        for(const auto& it: results)
+            found_batch += it != batched.end();
+    });
+
+    const auto per_op = [](const double total, const std::size_t n){ return total / n; };
+    std::cout << name << "\t" << pairs.size() << "\t"
+              << per_op(insert, pairs.size()) << "\t" << per_op(insert_batch, pairs.size()) << "\t"
+              << per_op(find, lookups.size()) << "\t" << per_op(find_batch, lookups.size()) << "\t"
+              << (found == found_batch ? "ok" : "MISMATCH") << "\n";
+}
+
+int main(int argc, char* argv[]){
+    const std::size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const std::size_t m = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000000;
+
+    std::mt19937 generator{42};
+    // even keys are in the tree, odd ones are not.
+    std::vector<int> keys(n);
+    for(std::size_t i = 0; i < n; ++i)
+        keys[i] = static_cast<int>(2*i);
+    std::shuffle(keys.begin(), keys.end(), generator);
+    std::vector<PairType> pairs;
+    for(const auto key: keys)
+        pairs.emplace_back(key, key);
+
+    std::uniform_int_distribution<int> distribution{0, static_cast<int>(2*n - 1)};
+    std::vector<int> lookups(m);
+    for(auto& key: lookups)
+        key = distribution(generator);
+
+    std::cout << "tree\tkeys\tinsert [ns/op]\tinsert_batch [ns/op]\tfind [ns/op]\tfind_batch [ns/op]\tcheck\n";
+    run<BST<int, int>>("unbalanced", pairs, lookups);
+    run<BST<int, int, std::less<const int>, avl_balance>>("AVL", pairs, lookups);
+    run<BST<int, int, std::less<const int>, red_black_balance>>("red-black", pairs, lookups);
+    return 0;
+}
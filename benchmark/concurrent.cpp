@@ -0,0 +1,206 @@
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <set>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "BST.h"
+#include "concurrent.h"
+
+// Multi-threaded stress test and throughput of concurrent_BST, against BST protected by one global
+// std::mutex and by one std::shared_mutex.
+//
+// The stress test runs threads inserting, erasing and finding keys at once. Every thread owns the
+// keys equal to its index modulo the number of threads, and checks that the tree agrees with the
+// std::set it keeps of its own keys; every key is mapped to twice itself, which every find checks.
+// Meanwhile, the main thread visits the tree with for_each and checks the order of the keys.
+// The throughput is measured with 1, 2, 4, ... threads, up to the number of hardware threads, on two
+// workloads: random, a read-mostly mix (90% find, 5% insert, 5% erase) of random keys on a tree filled
+// with half of them, and sorted, where every thread appends increasing keys, like timestamps or sequence
+// numbers, to an empty tree (50% insert) and looks up the keys it has inserted (50% find). The height
+// of the tree at the end shows that sorted keys do not make it degenerate.
+//
+// usage: ./concurrent.x [number of keys] [operations per thread]
+
+using clock_type = std::chrono::steady_clock;
+using PairType = std::pair<const int, int>;
+
+/**
+ * @brief BST protected by a global mutex, the baseline.
+ */
+class locked_BST{
+    BST<int, int, std::less<const int>, red_black_balance> tree;
+    std::mutex lock;
+
+    public:
+    bool insert(const PairType& pair){ std::lock_guard<std::mutex> guard{lock}; return tree.insert(pair).second; }
+    bool erase(const int key){ std::lock_guard<std::mutex> guard{lock}; tree.erase(key); return true; }
+    bool contains(const int key){ std::lock_guard<std::mutex> guard{lock}; return tree.contains(key); }
+    std::size_t height(){ std::lock_guard<std::mutex> guard{lock}; return tree.height(); }
+};
+
+/**
+ * @brief BST protected by a reader-writer lock.
+ */
+class shared_locked_BST{
+    BST<int, int, std::less<const int>, red_black_balance> tree;
+    std::shared_mutex lock;
+
+    public:
+    bool insert(const PairType& pair){ std::unique_lock<std::shared_mutex> guard{lock}; return tree.insert(pair).second; }
+    bool erase(const int key){ std::unique_lock<std::shared_mutex> guard{lock}; tree.erase(key); return true; }
+    bool contains(const int key){ std::shared_lock<std::shared_mutex> guard{lock}; return tree.contains(key); }
+    std::size_t height(){ std::shared_lock<std::shared_mutex> guard{lock}; return tree.height(); }
+};
+
+/**
+ * @brief Run the stress test. Returns the number of disagreements found, which must be zero.
+ */
+std::size_t stress(const std::size_t n, const std::size_t operations, const unsigned threads){
+    concurrent_BST<int, int> tree;
+    std::vector<std::set<int>> owned(threads);
+    std::atomic<std::size_t> errors{0};
+    std::atomic<unsigned> finished{0};
+    std::vector<std::thread> workers;
+    for(unsigned id = 0; id < threads; ++id){
+        workers.emplace_back([&, id]{
+            std::mt19937 generator{id};
+            auto& keys = owned[id];
+            for(std::size_t i = 0; i < operations; ++i){
+                const int key = static_cast<int>(generator() % (n / threads) * threads + id);
+                const int other = static_cast<int>(generator() % n);
+                switch(generator() % 4){
+                    case 0: errors += tree.insert({key, 2*key}) != keys.insert(key).second; break;
+                    case 1: errors += tree.erase(key) != (keys.erase(key) == 1); break;
+                    case 2: errors += tree.contains(key) != (keys.count(key) == 1); break;
+                    default:{
+                        const auto value = tree.find(other);
+                        errors += value && *value != 2*other;
+                    }
+                }
+            }
+            ++finished;
+        });
+    }
+    // meanwhile, visit the tree and check that the keys come out in ascending order.
+    while(finished < threads){
+        long previous = -1;
+        tree.for_each([&](const PairType& pair){
+            errors += pair.first <= previous || pair.second != 2*pair.first;
+            previous = pair.first;
+        });
+    }
+    for(auto& worker: workers)
+        worker.join();
+    std::size_t total = 0;
+    for(unsigned id = 0; id < threads; ++id){
+        total += owned[id].size();
+        for(const auto key: owned[id])
+            errors += !tree.contains(key);
+    }
+    errors += total != tree.size();
+    return errors;
+}
+
+/**
+ * @brief Measure the throughput of the read-mostly mix on a tree filled with half of the keys, and
+ * print it in millions of operations per second, with the final height of the tree.
+ */
+template <typename Tree>
+void run(const std::string& name, const std::size_t n, const std::size_t operations, const unsigned threads){
+    Tree tree;
+    std::vector<int> keys(n / 2);
+    std::mt19937 generator{42};
+    for(auto& key: keys)
+        key = static_cast<int>(generator() % n);
+    for(const auto key: keys)
+        tree.insert({key, key});
+
+    std::atomic<std::size_t> found{0};
+    std::vector<std::thread> workers;
+    const auto start = clock_type::now();
+    for(unsigned id = 0; id < threads; ++id){
+        workers.emplace_back([&, id]{
+            std::mt19937 generator{id};
+            std::size_t hits = 0;
+            for(std::size_t i = 0; i < operations; ++i){
+                const int key = static_cast<int>(generator() % n);
+                const auto dice = generator() % 100;
+                if(dice < 5)
+                    tree.insert({key, key});
+                else if(dice < 10)
+                    tree.erase(key);
+                else
+                    hits += tree.contains(key);
+            }
+            found += hits;
+        });
+    }
+    for(auto& worker: workers)
+        worker.join();
+    const auto stop = clock_type::now();
+    const auto seconds = std::chrono::duration<double>(stop - start).count();
+    std::cout << "random\t" << name << "\t" << threads << "\t" << threads * operations / seconds / 1e6 << "\t"
+              << tree.height() << "\n";
+}
+
+/**
+ * @brief Measure the throughput of the sorted workload on an empty tree, where every thread inserts
+ * the keys equal to its index modulo the number of threads in increasing order, and print it like run().
+ */
+template <typename Tree>
+void run_sorted(const std::string& name, const std::size_t operations, const unsigned threads){
+    Tree tree;
+    std::atomic<std::size_t> found{0};
+    std::vector<std::thread> workers;
+    const auto start = clock_type::now();
+    for(unsigned id = 0; id < threads; ++id){
+        workers.emplace_back([&, id]{
+            std::mt19937 generator{id};
+            std::size_t inserted = 0, hits = 0;
+            for(std::size_t i = 0; i < operations; ++i){
+                if(generator() % 2 || !inserted)
+                    tree.insert({static_cast<int>(inserted++ * threads + id), 1});
+                else
+                    hits += tree.contains(static_cast<int>(generator() % inserted * threads + id));
+            }
+            found += hits;
+        });
+    }
+    for(auto& worker: workers)
+        worker.join();
+    const auto stop = clock_type::now();
+    const auto seconds = std::chrono::duration<double>(stop - start).count();
+    std::cout << "sorted\t" << name << "\t" << threads << "\t" << threads * operations / seconds / 1e6 << "\t"
+              << tree.height() << "\n";
+}
+
+int main(int argc, char* argv[]){
+    const std::size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const std::size_t operations = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000000;
+    const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+
+    const auto errors = stress(std::min<std::size_t>(n, 100000), operations, std::max(4u, hardware));
+    std::cout << "stress test: " << (errors ? "FAILED" : "ok") << " (" << errors << " errors)\n";
+
+    std::cout << "workload\ttree\tthreads\tthroughput [Mops/s]\theight\n";
+    for(unsigned threads = 1; threads <= hardware; threads *= 2){
+        run<concurrent_BST<int, int>>("concurrent_BST", n, operations, threads);
+        run<shared_locked_BST>("BST + shared_mutex", n, operations, threads);
+        run<locked_BST>("BST + mutex", n, operations, threads);
+    }
+    for(unsigned threads = 1; threads <= hardware; threads *= 2){
+        run_sorted<concurrent_BST<int, int>>("concurrent_BST", operations, threads);
+        run_sorted<shared_locked_BST>("BST + shared_mutex", operations, threads);
+        run_sorted<locked_BST>("BST + mutex", operations, threads);
+    }
+    return errors ? 1 : 0;
+}
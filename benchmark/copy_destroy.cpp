@@ -0,0 +1,61 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <utility>
+
+#include "BST.h"
+
+// Throughput of copy, clear and destruction of a BST on a degenerate shape (sorted inserts, the
+// tree is a linked list) and on a balanced shape (after balance()).
+//
+// usage: ./copy_destroy.x [number of keys] [repetitions]
+
+using clock_type = std::chrono::steady_clock;
+using tree = BST<int, int>;
+
+/**
+ * @brief Run f and return the elapsed time in nanoseconds.
+ */
+template <typename Function> double time_ns(Function&& f){
+    const auto start = clock_type::now();
+    f();
+    const auto stop = clock_type::now();
+    return std::chrono::duration<double, std::nano>(stop - start).count();
+}
+
+/**
+ * @brief Measure copy, clear and destruction of copies of the given tree, and print the
+ * throughput in ns per node.
+ */
+void run(const std::string& shape, const tree& original, const std::size_t n, const int repetitions){
+    double copy = 0, clear = 0, destroy = 0;
+    for(int r = 0; r < repetitions; ++r){
+        {
+            tree* copied = nullptr;
+            copy += time_ns([&]{ copied = new tree{original}; });
+            destroy += time_ns([&]{ delete copied; });
+        }
+        tree copied{original};
+        clear += time_ns([&]{ copied.clear(); });
+    }
+    const auto per_node = [&](const double total){ return total / repetitions / n; };
+    std::cout << shape << "\t" << n << "\t"
+              << per_node(copy) << "\t" << per_node(clear) << "\t" << per_node(destroy) << "\n";
+}
+
+int main(int argc, char* argv[]){
+    const std::size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    const int repetitions = argc > 2 ? std::atoi(argv[2]) : 10;
+
+    tree degenerate;
+    for(std::size_t i = 0; i < n; ++i)
+        degenerate.insert({static_cast<int>(i), 0});
+    tree balanced{degenerate};
+    balanced.balance();
+
+    std::cout << "shape\tnodes\tcopy [ns/node]\tclear [ns/node]\tdestroy [ns/node]\n";
+    run("degenerate", degenerate, n, repetitions);
+    run("balanced", balanced, n, repetitions);
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "frozen.h"
+
+// Throughput of point lookups on the pointer-based BST (perfectly balanced by balance(), and
+// red-black) and on its snapshots frozen_BST, with the Eytzinger layout and with the blocked layout
+// searched with SIMD comparisons. Half of the looked up keys are present.
+//
+// usage: ./frozen_find.x [number of keys] [number of lookups]
+
+using clock_type = std::chrono::steady_clock;
+
+/**
+ * @brief Look up all the keys in the container, and print the throughput in ns per lookup.
+ */
+template <typename Container>
+void run(const std::string& name, const Container& container, const std::vector<int>& lookups){
+    std::size_t found = 0;
+    const auto start = clock_type::now();
+    for(const auto key: lookups)
+        found += container.find(key) != container.end();
+    const auto stop = clock_type::now();
+    const auto ns = std::chrono::duration<double, std::nano>(stop - start).count();
+    std::cout << name << "\t" << lookups.size() << "\t" << ns / lookups.size() << "\t" << found << "\n";
+}
+
+int main(int argc, char* argv[]){
+    const std::size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const std::size_t m = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 1000000;
+
+    std::mt19937 generator{42};
+    // even keys are in the tree, odd ones are not.
+    std::vector<int> keys(n);
+    for(std::size_t i = 0; i < n; ++i)
+        keys[i] = static_cast<int>(2*i);
+    std::shuffle(keys.begin(), keys.end(), generator);
+
+    BST<int, int> balanced;
+    BST<int, int, std::less<const int>, red_black_balance> red_black;
+    for(const auto key: keys){
+        balanced.insert({key, key});
+        red_black.insert({key, key});
+    }
+    balanced.balance();
+    const frozen_BST<int, int, std::less<const int>, eytzinger_layout<int>> eytzinger{balanced};
+    const frozen_BST<int, int> blocked{balanced};
+
+    std::uniform_int_distribution<int> distribution{0, static_cast<int>(2*n - 1)};
+    std::vector<int> lookups(m);
+    for(auto& key: lookups)
+        key = distribution(generator);
+
+    std::cout << "container\tlookups\tfind [ns/op]\tfound\n";
+    run("BST balanced", balanced, lookups);
+    run("BST red-black", red_black, lookups);
+    run("frozen_BST eytzinger", eytzinger, lookups);
+    run(_block_search<int>::vectorized ? "frozen_BST simd blocks" : "frozen_BST scalar blocks", blocked, lookups);
+    return 0;
+}
@@ -0,0 +1,155 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <new>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BST.h"
+
+// Bulk loading of a red-black BST from a stream of random pairs, produced on the fly so that the input
+// takes no memory: insert one by one, collect the stream into a vector then sort it and use the sorted
+// range constructor, and ingest() with chunks of several sizes. Then the same from k sorted ranges:
+// insert one by one against ingest_sorted(). Last, ingest() of n/10 random pairs into an unbalanced BST
+// built from n sorted keys, which is a list. For each, the time per pair and the peak of the heap bytes
+// per pair beyond the ones of the final tree (beyond the ones of the pairs ingested, for the last one).
+//
+// usage: ./ingest.x [number of pairs] [number of sorted ranges]
+
+using clock_type = std::chrono::steady_clock;
+using tree = BST<int, int, std::less<const int>, red_black_balance>;
+
+// bytes of the live allocations and their peak. Every block is prefixed by its size, so that operator
+// delete can subtract it.
+static std::size_t allocated = 0, peak = 0;
+
+void* operator new(const std::size_t size){
+    if(auto p = static_cast<std::size_t*>(std::malloc(size + alignof(std::max_align_t)))){
+        allocated += size;
+        peak = std::max(peak, allocated);
+        *p = size;
+        return reinterpret_cast<char*>(p) + alignof(std::max_align_t);
+    }
+    throw std::bad_alloc{};
+}
+void operator delete(void* const p) noexcept {
+    if(!p)
+        return;
+    const auto block = reinterpret_cast<std::size_t*>(reinterpret_cast<std::uintptr_t>(p) - alignof(std::max_align_t));
+    allocated -= *block;
+    std::free(block);
+}
+void operator delete(void* const p, std::size_t) noexcept { operator delete(p); }
+
+/**
+ * @brief Input iterator over n random pairs, generated when they are read.
+ */
+class random_pairs{
+    std::mt19937* generator;
+    std::size_t left;
+    std::pair<int, int> current;
+
+    public:
+    using value_type = std::pair<int, int>;
+    using reference = const value_type&;
+    using pointer = const value_type*;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::input_iterator_tag;
+
+    explicit random_pairs(std::mt19937* generator = nullptr, const std::size_t n = 0): generator{generator}, left{n} {
+        if(left)
+            current = {static_cast<int>((*generator)()), 1};
+    }
+    reference operator*() const noexcept { return current; }
+    random_pairs& operator++(){
+        if(--left)
+            current = {static_cast<int>((*generator)()), 1};
+        return *this;
+    }
+    friend bool operator==(const random_pairs& a, const random_pairs& b) noexcept { return a.left == b.left; }
+    friend bool operator!=(const random_pairs& a, const random_pairs& b) noexcept { return !(a == b); }
+};
+
+/**
+ * @brief Build a tree with load, and print the time in ns per pair and the peak of the heap bytes per
+ * pair beyond the ones of the final tree.
+ */
+template <typename Load> void run(const std::string& name, const std::size_t n, Load&& load){
+    const auto before = allocated;
+    peak = allocated;
+    const auto start = clock_type::now();
+    const auto loaded = load();
+    const auto stop = clock_type::now();
+    const auto tree_bytes = allocated - before;
+    std::cout << name << "\t" << n << "\t" << std::chrono::duration<double, std::nano>(stop - start).count() / n << "\t"
+              << static_cast<double>(peak - before - tree_bytes) / n << "\n";
+    delete loaded;
+}
+
+int main(int argc, char* argv[]){
+    const std::size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const std::size_t k = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 8;
+
+    std::cout << "method\tn\ttime [ns/pair]\textra heap [bytes/pair]\n";
+    run("insert", n, [n]{
+        std::mt19937 generator{0};
+        auto t = new tree;
+        for(random_pairs it{&generator, n}, end; it != end; ++it)
+            t->insert(*it);
+        return t;
+    });
+    run("vector + sort", n, [n]{
+        std::mt19937 generator{0};
+        std::vector<std::pair<int, int>> pairs{random_pairs{&generator, n}, random_pairs{}};
+        std::stable_sort(pairs.begin(), pairs.end(), [](const auto& a, const auto& b){ return a.first < b.first; });
+        return new tree{pairs.begin(), pairs.end()};
+    });
+    for(const std::size_t chunk: {std::size_t{1} << 12, std::size_t{1} << 16, std::size_t{1} << 20}){
+        run("ingest " + std::to_string(chunk), n, [n, chunk]{
+            std::mt19937 generator{0};
+            auto t = new tree;
+            t->ingest(random_pairs{&generator, n}, random_pairs{}, chunk);
+            return t;
+        });
+    }
+
+    // k sorted ranges of n/k pairs each.
+    std::vector<std::vector<std::pair<int, int>>> sorted(k);
+    std::mt19937 generator{1};
+    for(auto& range: sorted){
+        range.assign(random_pairs{&generator, n / k}, random_pairs{});
+        std::sort(range.begin(), range.end());
+    }
+    using range_iterator = std::vector<std::pair<int, int>>::const_iterator;
+    run("insert " + std::to_string(k) + " sorted", n, [&sorted]{
+        auto t = new tree;
+        for(const auto& range: sorted)
+            for(const auto& pair: range)
+                t->insert(pair);
+        return t;
+    });
+    run("ingest_sorted " + std::to_string(k), n, [&sorted]{
+        std::vector<std::pair<range_iterator, range_iterator>> ranges;
+        for(const auto& range: sorted)
+            ranges.emplace_back(range.cbegin(), range.cend());
+        auto t = new tree;
+        t->ingest_sorted(std::move(ranges));
+        return t;
+    });
+
+    // sorted keys make the unbalanced BST a list.
+    auto degenerate = new BST<int, int>;
+    for(std::size_t i = 0; i < n; ++i)
+        degenerate->insert(degenerate->end(), {static_cast<int>(i), 1});
+    run("ingest into list of " + std::to_string(n), n / 10, [n, degenerate]{
+        std::mt19937 generator{2};
+        degenerate->ingest(random_pairs{&generator, n / 10}, random_pairs{});
+        return degenerate;
+    });
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include <iostream>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BST.h"
+#include "compact.h"
+
+// Memory per entry of a map from int to int: std::map, the BST with and without balancing and with
+// the pool allocator, and compact_BST, before and after shrinking its array to fit. The benchmark
+// counts the bytes requested from operator new by each tree holding n random keys (the overhead of
+// malloc itself is not included), and times the insertion of the keys and their lookup.
+//
+// usage: ./memory.x [number of keys]
+
+using clock_type = std::chrono::steady_clock;
+using PairType = std::pair<const int, int>;
+
+// bytes and number of the live allocations. Every block is prefixed by its size, so that operator
+// delete can subtract it.
+static std::size_t allocated = 0, allocations = 0;
+
+void* operator new(const std::size_t size){
+    if(auto p = static_cast<std::size_t*>(std::malloc(size + alignof(std::max_align_t)))){
+        allocated += size;
+        ++allocations;
+        *p = size;
+        return reinterpret_cast<char*>(p) + alignof(std::max_align_t);
+    }
+    throw std::bad_alloc{};
+}
+void operator delete(void* const p) noexcept {
+    if(!p)
+        return;
+    const auto block = reinterpret_cast<std::size_t*>(reinterpret_cast<std::uintptr_t>(p) - alignof(std::max_align_t));
+    allocated -= *block;
+    --allocations;
+    std::free(block);
+}
+void operator delete(void* const p, std::size_t) noexcept { operator delete(p); }
+
+/**
+ * @brief Run f and return the elapsed time in nanoseconds.
+ */
+template <typename Function> double time_ns(Function&& f){
+    const auto start = clock_type::now();
+    f();
+    const auto stop = clock_type::now();
+    return std::chrono::duration<double, std::nano>(stop - start).count();
+}
+
+/**
+ * @brief Insert the keys in a new tree, look them all up, and print the bytes and allocations per
+ * entry held by the tree, and the time per insertion and lookup. shrink is called on the tree after
+ * the insertions.
+ */
+template <typename Tree, typename Shrink>
+void run(const std::string& name, const std::vector<int>& keys, Shrink&& shrink){
+    const auto bytes_before = allocated, allocations_before = allocations;
+    Tree* tree = nullptr;
+    const double insert = time_ns([&]{
+        tree = new Tree{};
+        for(const auto key: keys)
+            tree->insert(PairType{key, key});
+    });
+    shrink(*tree);
+    long long sum = 0;
+    const double find = time_ns([&]{
+        for(const auto key: keys)
+            sum += tree->find(key)->second;
+    });
+    const auto n = static_cast<double>(keys.size());
+    std::cout << name << "\t" << keys.size() << "\t" << (allocated - bytes_before) / n << "\t"
+              << (allocations - allocations_before) / n << "\t" << insert / n << "\t" << find / n << "\n";
+    delete tree;
+    if(sum == 42)
+        std::cout << "";
+}
+
+int main(int argc, char* argv[]){
+    const std::size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    std::mt19937 generator{0};
+    std::vector<int> keys;
+    for(std::size_t i = 0; i < n; ++i)
+        keys.push_back(static_cast<int>(generator()));
+
+    const auto keep = [](auto&){};
+    std::cout << "tree\tn\theap [bytes/entry]\theap [allocs/entry]\tinsert [ns/op]\tfind [ns/op]\n";
+    run<std::map<int, int>>("std::map", keys, keep);
+    run<BST<int, int>>("BST", keys, keep);
+    run<BST<int, int, std::less<const int>, red_black_balance>>("BST red-black", keys, keep);
+    run<BST<int, int, std::less<const int>, red_black_balance, pool_allocator<PairType>>>("BST red-black pool", keys, keep);
+    run<compact_BST<int, int>>("compact_BST", keys, keep);
+    run<compact_BST<int, int>>("compact_BST shrunk", keys, [](auto& tree){ tree.shrink_to_fit(); });
+    return 0;
+}
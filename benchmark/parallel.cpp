@@ -0,0 +1,92 @@
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "BST.h"
+
+// Scaling of the parallel operations of a red-black BST with the number of threads: construction
+// from a sorted range, copy, balance and parallel_for_each. The row with 0 threads is the sequential
+// version of each operation.
+//
+// usage: ./parallel.x [number of keys] [maximum number of threads]
+
+using clock_type = std::chrono::steady_clock;
+using tree = BST<int, int, std::less<const int>, red_black_balance>;
+
+/**
+ * @brief Run f and return the elapsed time in nanoseconds.
+ */
+template <typename Function> double time_ns(Function&& f){
+    const auto start = clock_type::now();
+    f();
+    const auto stop = clock_type::now();
+    return std::chrono::duration<double, std::nano>(stop - start).count();
+}
+
+/**
+ * @brief Measure the operations with the given number of threads (0 for the sequential versions),
+ * and print the throughput in ns per node.
+ */
+void run(const std::vector<std::pair<int, int>>& sorted, const tree& shuffled, const std::size_t threads){
+    const parallel_policy policy{threads};
+    double build, copy, balance, for_each;
+    std::atomic<long long> sum{0};
+    {
+        tree* built = nullptr;
+        build = time_ns([&]{
+            built = threads ? new tree{policy, sorted.begin(), sorted.end()} : new tree{sorted.begin(), sorted.end()};
+        });
+        delete built;
+    }
+    {
+        tree* copied = nullptr;
+        copy = time_ns([&]{ copied = threads ? new tree{shuffled, policy} : new tree{shuffled}; });
+        delete copied;
+    }
+    {
+        tree unbalanced{shuffled};
+        balance = time_ns([&]{
+            if(threads)
+                unbalanced.balance(policy);
+            else
+                unbalanced.balance();
+        });
+        for_each = time_ns([&]{
+            if(threads)
+                unbalanced.parallel_for_each([&sum](const std::pair<const int, int>& pair){ sum += pair.second; }, policy);
+            else
+                for(const auto& pair: unbalanced)
+                    sum += pair.second;
+        });
+    }
+    const auto n = static_cast<double>(sorted.size());
+    std::cout << threads << "\t" << build / n << "\t" << copy / n << "\t" << balance / n << "\t" << for_each / n << "\n";
+}
+
+int main(int argc, char* argv[]){
+    const std::size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const std::size_t hardware = argc > 2 ? std::strtoul(argv[2], nullptr, 10)
+                                          : std::max(1u, std::thread::hardware_concurrency());
+
+    std::vector<std::pair<int, int>> sorted;
+    for(std::size_t i = 0; i < n; ++i)
+        sorted.emplace_back(static_cast<int>(i), 1);
+    auto keys = sorted;
+    std::shuffle(keys.begin(), keys.end(), std::mt19937{0});
+    tree shuffled;
+    for(const auto& pair: keys)
+        shuffled.insert(pair);
+
+    std::cout << "threads\tbuild [ns/node]\tcopy [ns/node]\tbalance [ns/node]\tfor_each [ns/node]\n";
+    run(sorted, shuffled, 0);
+    for(std::size_t threads = 1; threads <= hardware; threads *= 2)
+        run(sorted, shuffled, threads);
+    return 0;
+}
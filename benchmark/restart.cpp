@@ -0,0 +1,92 @@
+#include <iostream>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BST.h"
+#include "serialize.h"
+
+// Cost of a restart of a red-black BST saved to a file, with both layouts of the records: the time
+// to save it, to load it back into a BST, and to map it with mapped_BST and answer the first lookup,
+// and the throughput of find with random keys on the loaded tree and on the mapped view.
+//
+// usage: ./restart.x [number of keys] [file]
+
+using clock_type = std::chrono::steady_clock;
+using tree = BST<int, int, std::less<const int>, red_black_balance>;
+
+/**
+ * @brief Run f and return the elapsed time in nanoseconds.
+ */
+template <typename Function> double time_ns(Function&& f){
+    const auto start = clock_type::now();
+    f();
+    const auto stop = clock_type::now();
+    return std::chrono::duration<double, std::nano>(stop - start).count();
+}
+
+/**
+ * @brief Return the time per lookup in ns of find on the given keys.
+ */
+template <typename Tree> double find_ns(const Tree& t, const std::vector<int>& keys){
+    long long sum = 0;
+    const auto elapsed = time_ns([&]{
+        for(const auto key: keys){
+            const auto it = t.find(key);
+            sum += it != t.end() ? it->second : 0;
+        }
+    });
+    if(sum == 42)
+        std::cout << "";
+    return elapsed / keys.size();
+}
+
+/**
+ * @brief Save the tree with a layout, load and map it back, and print the times in ms and ns per lookup.
+ */
+void run(const std::string& name, const tree& original, const std::string& path, const serial_layout layout,
+         const std::vector<int>& keys){
+    const double save_ms = time_ns([&]{ save(original, path, layout); }) / 1e6;
+    double load_ms, lookup;
+    {
+        tree* loaded = nullptr;
+        load_ms = time_ns([&]{ loaded = new tree{load<tree>(path)}; }) / 1e6;
+        lookup = find_ns(*loaded, keys);
+        delete loaded;
+    }
+    double map_ms, mapped;
+    {
+        mapped_BST<int, int>* view = nullptr;
+        map_ms = time_ns([&]{
+            view = new mapped_BST<int, int>{path};
+            view->contains(keys.front());
+        }) / 1e6;
+        mapped = find_ns(*view, keys);
+        delete view;
+    }
+    std::cout << name << "\t" << keys.size() << "\t" << save_ms << "\t" << load_ms << "\t" << map_ms << "\t"
+              << lookup << "\t" << mapped << "\n";
+}
+
+int main(int argc, char* argv[]){
+    const std::size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    const std::string path = argc > 2 ? argv[2] : "restart.bin";
+
+    std::mt19937 generator{0};
+    tree original;
+    std::vector<int> keys;
+    for(std::size_t i = 0; i < n; ++i){
+        keys.push_back(static_cast<int>(generator() % (2*n)));
+        original.insert({keys.back(), 1});
+    }
+
+    std::cout << "layout\tn\tsave [ms]\tload [ms]\tmap + find [ms]\tfind loaded [ns/op]\tfind mapped [ns/op]\n";
+    run("sorted", original, path, serial_layout::sorted, keys);
+    run("eytzinger", original, path, serial_layout::eytzinger, keys);
+    std::remove(path.c_str());
+    return 0;
+}
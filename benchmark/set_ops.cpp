@@ -0,0 +1,88 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BST.h"
+
+// Time of the union, intersection and difference of a red-black tree of n keys with trees of m keys,
+// for m from n/1000 to n: the join-based operations, which move the nodes, against inserting (erasing)
+// the keys of the smaller tree one by one.
+//
+// usage: ./set_ops.x [number of keys]
+
+using clock_type = std::chrono::steady_clock;
+using tree = BST<int, int, std::less<const int>, red_black_balance>;
+
+/**
+ * @brief Run f and return the elapsed time in microseconds.
+ */
+template <typename Function> double time_us(Function&& f){
+    const auto start = clock_type::now();
+    f();
+    const auto stop = clock_type::now();
+    return std::chrono::duration<double, std::micro>(stop - start).count();
+}
+
+/**
+ * @brief Build a tree of n random keys out of [0, range).
+ */
+tree random_tree(const std::size_t n, const std::size_t range, std::mt19937& generator){
+    tree t;
+    for(std::size_t i = 0; i < n; ++i)
+        t.insert({static_cast<int>(generator() % range), 0});
+    return t;
+}
+
+/**
+ * @brief Measure the operations on copies of the given trees, and print the times in microseconds.
+ */
+void run(const tree& large, const tree& small, const std::size_t n, const std::size_t m){
+    double union_join, union_insert, intersect, difference_join, difference_erase;
+    {
+        tree a{large}, b{small};
+        union_join = time_us([&]{ a.union_with(std::move(b)); });
+    }
+    {
+        tree a{large};
+        union_insert = time_us([&]{
+            for(const auto& pair: small)
+                a.insert(pair);
+        });
+    }
+    {
+        tree a{large}, b{small};
+        intersect = time_us([&]{ a.intersect(std::move(b)); });
+    }
+    {
+        tree a{large}, b{small};
+        difference_join = time_us([&]{ a.difference(std::move(b)); });
+    }
+    {
+        tree a{large};
+        difference_erase = time_us([&]{
+            for(const auto& pair: small)
+                a.erase(pair.first);
+        });
+    }
+    std::cout << n << "\t" << m << "\t" << union_join << "\t" << union_insert << "\t" << intersect << "\t"
+              << difference_join << "\t" << difference_erase << "\n";
+}
+
+int main(int argc, char* argv[]){
+    const std::size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    std::mt19937 generator{0};
+    const auto large = random_tree(n, 4*n, generator);
+    std::cout << "n\tm\tunion [us]\tinsert loop [us]\tintersect [us]\tdifference [us]\terase loop [us]\n";
+    for(std::size_t m = n / 1000; m <= n; m *= 10){
+        if(!m)
+            continue;
+        const auto small = random_tree(m, 4*n, generator);
+        run(large, small, n, m);
+    }
+    return 0;
+}
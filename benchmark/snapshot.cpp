@@ -0,0 +1,84 @@
+#include <iostream>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "BST.h"
+#include "persistent.h"
+
+// Cost of taking a snapshot of a tree and of updating the tree afterwards: a copy of a red-black
+// BST against a persistent_BST, whose snapshots share the nodes. For the updates, the benchmark also
+// counts the allocations per operation (path copying allocates O(log n) nodes per update).
+//
+// usage: ./snapshot.x [number of keys] [number of snapshots]
+
+using clock_type = std::chrono::steady_clock;
+using PairType = std::pair<const int, int>;
+
+// number of calls to operator new, to count the allocations of the updates.
+static std::size_t allocations = 0;
+
+void* operator new(const std::size_t size){
+    ++allocations;
+    if(auto p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc{};
+}
+void operator delete(void* const p) noexcept { std::free(p); }
+void operator delete(void* const p, std::size_t) noexcept { std::free(p); }
+
+/**
+ * @brief Run f and return the elapsed time in nanoseconds.
+ */
+template <typename Function> double time_ns(Function&& f){
+    const auto start = clock_type::now();
+    f();
+    const auto stop = clock_type::now();
+    return std::chrono::duration<double, std::nano>(stop - start).count();
+}
+
+/**
+ * @brief Take snapshots of a tree, updating it (one insert and one erase of random keys) after each
+ * one, and print the cost of a snapshot in ns and of an update in ns and allocations.
+ */
+template <typename Tree, typename Snapshot>
+void run(const std::string& name, Tree& tree, const std::size_t n, const std::size_t snapshots, Snapshot&& snapshot){
+    std::mt19937 generator{1};
+    std::vector<Tree> taken;
+    taken.reserve(snapshots);
+    double take = 0, update = 0;
+    std::size_t updates = 0;
+    for(std::size_t i = 0; i < snapshots; ++i){
+        take += time_ns([&]{ taken.push_back(snapshot(tree)); });
+        const int inserted = static_cast<int>(generator() % (2*n));
+        const int erased = static_cast<int>(generator() % (2*n));
+        const auto before = allocations;
+        update += time_ns([&]{
+            tree.insert({inserted, 0});
+            tree.erase(erased);
+        });
+        updates += allocations - before;
+    }
+    std::cout << name << "\t" << n << "\t" << take / snapshots << "\t" << update / (2*snapshots) << "\t"
+              << static_cast<double>(updates) / (2*snapshots) << "\n";
+}
+
+int main(int argc, char* argv[]){
+    const std::size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+    const std::size_t snapshots = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 100;
+
+    std::mt19937 generator{0};
+    BST<int, int, std::less<const int>, red_black_balance> copied;
+    for(std::size_t i = 0; i < n; ++i)
+        copied.insert({static_cast<int>(generator() % (2*n)), 0});
+    persistent_BST<int, int> persistent{copied};
+
+    std::cout << "tree\tnodes\tsnapshot [ns]\tupdate [ns/op]\tupdate [allocs/op]\n";
+    run("BST red-black copy", copied, n, snapshots, [](const auto& tree){ return tree; });
+    run("persistent_BST", persistent, n, snapshots, [](const auto& tree){ return tree.snapshot(); });
+    return 0;
+}
@@ -0,0 +1,213 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "BST.h"
+
+// Benchmark suite of the BST against std::map, meant to be tracked over time: for every distribution of
+// the keys (random, sorted, reverse sorted, zipfian) and size (10^3, 10^4, ... up to the given maximum),
+// every tree is filled with n keys in the order of the distribution, which are then looked up, iterated,
+// copied, balanced (BST only) and erased in the same order.
+//
+// The output is a tab-separated table with a header line, one row per operation: time and allocations
+// per operation (per node for iterate, copy and balance), height of the tree after the operation (NA for
+// std::map), and peak resident set size of the measurement in KiB. On POSIX systems every tree is
+// measured in a child process, so that the peak RSS is its own. The unbalanced BST is skipped on sorted
+// keys above 10^4, where it degenerates into a list and takes O(n^2).
+//
+// usage: ./suite.x [maximum number of keys]
+
+using clock_type = std::chrono::steady_clock;
+using PairType = std::pair<const int, int>;
+
+// number of calls to operator new.
+static std::size_t allocations = 0;
+
+void* operator new(const std::size_t size){
+    ++allocations;
+    if(auto p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc{};
+}
+void operator delete(void* const p) noexcept { std::free(p); }
+void operator delete(void* const p, std::size_t) noexcept { std::free(p); }
+
+/**
+ * @brief Run f and return the elapsed time in nanoseconds.
+ */
+template <typename Function> double time_ns(Function&& f){
+    const auto start = clock_type::now();
+    f();
+    const auto stop = clock_type::now();
+    return std::chrono::duration<double, std::nano>(stop - start).count();
+}
+
+/**
+ * @brief Returns the peak resident set size of the process in KiB, 0 if it is not available.
+ */
+long peak_rss_kib(){
+#if defined(__APPLE__)
+    rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) ? 0 : usage.ru_maxrss / 1024;
+#elif defined(__unix__)
+    rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) ? 0 : usage.ru_maxrss;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Returns n keys in the order of a distribution: random (uniform over the int), sorted,
+ * reverse (sorted in decreasing order) or zipfian (ranks drawn with exponent 0.99 over n values, by the
+ * approximation of Gray et al., scattered over the int by a multiplicative hash).
+ */
+std::vector<int> make_keys(const std::string& distribution, const std::size_t n){
+    std::vector<int> keys(n);
+    std::mt19937 generator{0};
+    if(distribution == "random"){
+        for(auto& key: keys)
+            key = static_cast<int>(generator());
+    }
+    else if(distribution == "sorted"){
+        for(std::size_t i = 0; i < n; ++i)
+            keys[i] = static_cast<int>(i);
+    }
+    else if(distribution == "reverse"){
+        for(std::size_t i = 0; i < n; ++i)
+            keys[i] = static_cast<int>(n - 1 - i);
+    }
+    else{
+        const double theta = 0.99;
+        double zeta_n = 0;
+        for(std::size_t i = 1; i <= n; ++i)
+            zeta_n += 1 / std::pow(static_cast<double>(i), theta);
+        const double zeta_2 = 1 + std::pow(0.5, theta);
+        const double alpha = 1 / (1 - theta);
+        const double eta = (1 - std::pow(2.0 / n, 1 - theta)) / (1 - zeta_2 / zeta_n);
+        std::uniform_real_distribution<double> uniform{0, 1};
+        for(auto& key: keys){
+            const double u = uniform(generator);
+            const double uz = u * zeta_n;
+            std::uint32_t rank = uz < 1 ? 0 : uz < zeta_2 ? 1 : static_cast<std::uint32_t>(n * std::pow(eta * u - eta + 1, alpha));
+            key = static_cast<int>(rank * 2654435761u);
+        }
+    }
+    return keys;
+}
+
+/**
+ * @brief Height of a tree, NA for the trees which do not expose it.
+ */
+template <typename Tree> std::string height(const Tree& tree){
+    if constexpr (std::is_same<Tree, std::map<int, int>>::value){
+        (void)tree;
+        return "NA";
+    }
+    else
+        return std::to_string(tree.height());
+}
+
+/**
+ * @brief Measure every operation on a tree of the given type, and print one row per operation.
+ */
+template <typename Tree>
+void run(const std::string& distribution, const std::string& name, const std::vector<int>& keys){
+    const auto n = static_cast<double>(keys.size());
+    struct row{ std::string operation; double ns; double allocs; std::string height; };
+    std::vector<row> rows;
+    rows.reserve(8);
+    const auto measure = [&](const std::string& operation, const Tree& tree, auto&& f){
+        const auto before = allocations;
+        const auto elapsed = time_ns(f);
+        rows.push_back({operation, elapsed / n, (allocations - before) / n, height(tree)});
+    };
+
+    Tree tree;
+    measure("insert", tree, [&]{
+        for(const auto key: keys)
+            tree.insert(PairType{key, key});
+    });
+    long long sum = 0;
+    measure("find", tree, [&]{
+        for(const auto key: keys)
+            sum += tree.find(key)->second;
+    });
+    measure("iterate", tree, [&]{
+        for(const auto& pair: tree)
+            sum += pair.second;
+    });
+    {
+        Tree* copy = nullptr;
+        measure("copy", tree, [&]{ copy = new Tree{tree}; });
+        delete copy;
+    }
+    if constexpr (!std::is_same<Tree, std::map<int, int>>::value)
+        measure("balance", tree, [&]{ tree.balance(); });
+    measure("erase", tree, [&]{
+        for(const auto key: keys)
+            tree.erase(key);
+    });
+    const auto rss = peak_rss_kib();
+    for(const auto& r: rows)
+        std::cout << distribution << "\t" << keys.size() << "\t" << name << "\t" << r.operation << "\t" << r.ns << "\t"
+                  << r.allocs << "\t" << r.height << "\t" << rss << "\n";
+    if(sum == 42)
+        std::cout << "";
+}
+
+/**
+ * @brief Generate the keys and measure a tree, in a child process if possible.
+ */
+template <typename Tree>
+void measure_tree(const std::string& distribution, const std::string& name, const std::size_t n){
+#if defined(__unix__) || defined(__APPLE__)
+    std::cout.flush();
+    const auto pid = fork();
+    if(pid == 0){
+        run<Tree>(distribution, name, make_keys(distribution, n));
+        std::cout.flush();
+        _exit(0);
+    }
+    if(pid > 0){
+        int status;
+        waitpid(pid, &status, 0);
+        return;
+    }
+#endif
+    run<Tree>(distribution, name, make_keys(distribution, n));
+}
+
+int main(int argc, char* argv[]){
+    const std::size_t max_n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+
+    std::cout << "distribution\tn\ttree\toperation\tns/op\tallocs/op\theight\tpeak RSS [KiB]\n";
+    for(const std::string distribution: {"random", "sorted", "reverse", "zipfian"}){
+        for(std::size_t n = 1000; n <= max_n; n *= 10){
+            const bool ordered = distribution == "sorted" || distribution == "reverse";
+            measure_tree<std::map<int, int>>(distribution, "std::map", n);
+            if(!ordered || n <= 10000)
+                measure_tree<BST<int, int>>(distribution, "BST", n);
+            measure_tree<BST<int, int, std::less<const int>, avl_balance>>(distribution, "BST avl", n);
+            measure_tree<BST<int, int, std::less<const int>, red_black_balance>>(distribution, "BST red-black", n);
+            measure_tree<BST<int, int, std::less<const int>, red_black_balance, pool_allocator<PairType>>>(distribution, "BST red-black pool", n);
+        }
+    }
+    return 0;
+}
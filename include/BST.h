@@ -6,11 +6,31 @@
 #include <memory>
 #include <iterator>
 #include <algorithm>
-#include <vector>
+#include <atomic>
 #include <cassert>
+#include <numeric>
+#include <optional>
+#include <tuple>
+#include <vector>
+#include <type_traits>
 
 #include "iterator.h"
 #include "node.h"
+#include "balance.h"
+#include "pool.h"
+#include "trace.h"
+#include "augment.h"
+#include "parallel.h"
+#include "ingest.h"
+
+/**
+ * @brief Type trait telling whether the arguments of emplace() are a key of type KT and a value, so
+ * that the key can be looked up before constructing the pair.
+ */
+template<typename KT, typename ... Types>
+struct _is_key_value: std::false_type{};
+template<typename KT, typename K, typename V>
+struct _is_key_value<KT, K, V>: std::is_same<KT, std::remove_cv_t<std::remove_reference_t<K>>>{};
 
 /**
  * @brief Binary Search Tree class templated on KT (key type), VT (value type), and F (type of comparison operator).
@@ -18,83 +38,521 @@
  * @tparam KT Key type of nodes of BST.
  * @tparam VT Value type of nodes of BST.
  * @tparam F Type of comparison operator to induce ordering in BST. Default: std::less<const KT>.
+ * @tparam Balance Balancing policy (see balance.h): no_balance, avl_balance or red_black_balance.
+ * Default: no_balance.
+ * @tparam Alloc Allocator of std::pair<const KT, VT>, rebound to allocate the nodes (see pool.h for
+ * a slab allocator). Default: std::allocator<std::pair<const KT, VT>>.
+ * @tparam Trace Diagnostics policy receiving the events of the tree (see trace.h): no_trace,
+ * counting_trace, ring_buffer_trace<N> or stats_trace. Default: no_trace.
+ * @tparam Augment Augmentation policy summarizing every subtree in its root (see augment.h): no_augment,
+ * order_statistics or monoid_augment<M>. Default: no_augment.
  */
-template<typename KT, typename VT, typename F = std::less<const KT>>
+template<typename KT, typename VT, typename F = std::less<const KT>, typename Balance = no_balance,
+         typename Alloc = std::allocator<std::pair<const KT, VT>>, typename Trace = no_trace,
+         typename Augment = no_augment>
 class BST{
     using PairType = std::pair<const KT, VT>; // Pair Type
 
-    using node = _node<KT, VT>; 
-    using iterator = _iterator<node, PairType>;
+    using node_data = _node_data<typename Balance::node_data, typename Augment::node_data>;
+    using node = _node<KT, VT, node_data>; 
+    using link = typename node::link;
+    using node_allocator = typename std::allocator_traits<Alloc>::template rebind_alloc<node>;
+    using node_traits = std::allocator_traits<node_allocator>;
+    static_assert(std::is_same<typename node_traits::pointer, node*>::value,
+                  "BST requires an allocator returning raw pointers.");
+    // true if the augmentation caches the values, which are then read only through iterators and operator[].
+    static constexpr bool _readonly_values = _aggregates_values<Augment>::value;
+    using iterator = std::conditional_t<_readonly_values, _iterator<node, const PairType>, _iterator<node, PairType>>;
     using const_iterator = _iterator<node, const PairType>;
 
     using IteratorBoolPair = std::pair<iterator, bool>; // Iterator-Bool Pair type
+    // cost of an operation, counted only if the diagnostics policy receives it.
+    using op_counter = _operation_counter<_traces_operations<Trace>::value>;
 
     F f;
-    std::size_t _size;
-    std::unique_ptr<node> head;
+    node_allocator alloc;
+    // mutable, since events are recorded by const member functions as well.
+    mutable Trace _trace;
+    std::size_t _size{0};
+    link head;
+    // first and last node in order, so that begin() is O(1) and end() can be decremented.
+    struct _extremes{
+        node* leftmost{nullptr};
+        node* rightmost{nullptr};
+    };
+    // the iterators point to the last node through the header: on the heap, it moves with the nodes, and
+    // the iterators stay valid when the tree is moved. A moved-from tree has no header until its next node.
+    std::unique_ptr<_extremes> _ends{new _extremes{}};
+    // last node seen by the iterators of a tree without a header.
+    static constexpr node* _no_node{nullptr};
+
+    // the balancing policy needs the rotations and the head of the tree.
+    friend Balance;
+
+    // number of descents interleaved by the batched operations.
+    static constexpr std::size_t _batch_width = 16;
+
+    // number of nodes below which the parallel operations run sequentially.
+    static constexpr std::size_t _parallel_grain = std::size_t{1} << 14;
+
+    // true if the nodes carry an augmentation which must be kept up to date.
+    static constexpr bool _augmented = !std::is_same<Augment, no_augment>::value;
+
+    /**
+     * @brief Helper function to recompute the data of a node (balancing and augmentation) from its children.
+     * 
+     * @param _node Pointer to node.
+     */
+    void _update(node* const _node) noexcept {
+        Balance::update(_node);
+        Augment::update(_node);
+    }
+    /**
+     * @brief Helper function to recompute the augmentation of a node and of all its ancestors, after the
+     * subtree rooted at the node has changed. Does nothing if the tree is not augmented.
+     * 
+     * @param _node Pointer to node (nullptr is allowed).
+     */
+    void _update_path(node* _node) noexcept {
+        if constexpr (_augmented){
+            for(; _node; _node = _node->parent){
+                Augment::update(_node);
+            }
+        }
+    }
+
+    /**
+     * @brief Helper function returning the first node in order, nullptr if the tree is empty.
+     * 
+     * @return node*
+     */
+    node* _first() const noexcept {
+        return _ends ? _ends->leftmost : nullptr;
+    }
+    /**
+     * @brief Helper function returning the location of the last node in order, through which the
+     * iterators of this tree decrement end().
+     * 
+     * @return node* const*
+     */
+    node* const* _last() const noexcept {
+        return _ends ? &_ends->rightmost : &_no_node;
+    }
+    /**
+     * @brief Helper function to store the first and the last node in order. Only an empty tree may
+     * have no header.
+     * 
+     * @param leftmost Pointer to the first node.
+     * @param rightmost Pointer to the last node.
+     */
+    void _set_extremes(node* const leftmost, node* const rightmost) noexcept {
+        assert(_ends || !leftmost);
+        if(_ends){
+            _ends->leftmost = leftmost;
+            _ends->rightmost = rightmost;
+        }
+    }
+    /**
+     * @brief Helper function to give a new header to a moved-from tree, before nodes are linked into it.
+     * 
+     */
+    void _ensure_header(){
+        if(!_ends)
+            _ends.reset(new _extremes{});
+    }
+
+    /**
+     * @brief Helper function to allocate and construct a node through the allocator.
+     * 
+     * @tparam Types
+     * @param args Arguments forwarded to the constructor of the node.
+     * @return node* Pointer to the new node.
+     */
+    template <typename ... Types> node* _create_node(Types&& ... args){
+        _ensure_header();
+        auto _node = node_traits::allocate(alloc, 1);
+        try{
+            node_traits::construct(alloc, _node, std::forward<Types>(args)...);
+        }
+        catch(...){
+            node_traits::deallocate(alloc, _node, 1);
+            throw;
+        }
+        return _node;
+    }
+    /**
+     * @brief Helper function to create a node holding a pair, recording whether the pair is copied
+     * or moved into the node.
+     * 
+     * @tparam OT
+     * @param pair Pair to be stored in the node.
+     * @return node* Pointer to the new node.
+     */
+    template <typename OT> node* _create_pair_node(OT&& pair){
+        _trace.record(std::is_lvalue_reference<OT>::value ? trace_event::lvalue_node_ctor : trace_event::rvalue_node_ctor);
+        return _create_node(std::forward<OT>(pair));
+    }
+    /**
+     * @brief Helper function to destroy and deallocate a node through the allocator. The
+     * children of the node are not touched.
+     * 
+     * @param _node Pointer to node.
+     */
+    void _destroy_node(node* const _node) noexcept {
+        node_traits::destroy(alloc, _node);
+        node_traits::deallocate(alloc, _node, 1);
+    }
+    /**
+     * @brief Helper function to destroy and deallocate all the nodes of a subtree. The subtree is
+     * visited in post-order following the parent links, so no recursion and no extra memory are
+     * needed regardless of the depth of the tree. The subtree is unlinked from its parent.
+     * 
+     * @param _node Pointer to the root of the subtree.
+     */
+    void _destroy_subtree(node* _node) noexcept {
+        if(!_node)
+            return;
+        const auto stop = _node->parent;
+        while(_node != stop){
+            if(_node->left)
+                _node = _node->left.get();
+            else if(_node->right)
+                _node = _node->right.get();
+            else{
+                // _node is a leaf: detach it from its parent, free it, and go back up.
+                auto parent = _node->parent;
+                if(parent){
+                    if(parent->left.get() == _node)
+                        parent->left.release();
+                    else
+                        parent->right.release();
+                }
+                _destroy_node(_node);
+                _node = parent;
+            }
+        }
+    }
+    /**
+     * @brief Helper function to release at once all the memory of the nodes, when the allocator
+     * supports it (e.g. pool_allocator) and the nodes do not need to be destroyed one by one.
+     * 
+     * @return true if the memory has been released, false if the nodes must be destroyed one by one.
+     */
+    bool _release_all_nodes() noexcept {
+        if constexpr (_has_release<node_allocator>::value &&
+                      std::is_trivially_destructible<PairType>::value &&
+                      std::is_trivially_destructible<node_data>::value)
+            return alloc.release();
+        else
+            return false;
+    }
+    /**
+     * @brief Helper function to copy the subtrees of a node. Used for the sole purpose of copying a BST.
+     * The original and the copy are visited in lockstep following the parent links: a child is
+     * copied the first time its parent is reached, and once both children of a node have been
+     * copied the visit goes back up. Hence, no recursion and no extra memory are needed regardless
+     * of the depth of the tree.
+     * 
+     * @param root Pointer to the node to be copied.
+     * @param root_copy Pointer to the copy of the node, without children.
+     */
+    void _copy_children(const node* const root, node* const root_copy){
+        auto from = root;
+        auto to = root_copy;
+        while(true){
+            if(from->left && !to->left){
+                to->left.reset(_create_node(*from->left, to));
+                from = from->left.get();
+                to = to->left.get();
+            }
+            else if(from->right && !to->right){
+                to->right.reset(_create_node(*from->right, to));
+                from = from->right.get();
+                to = to->right.get();
+            }
+            else if(from == root){
+                return;
+            }
+            else{
+                from = from->parent;
+                to = to->parent;
+            }
+        }
+    }
+
+    /**
+     * @brief Helper function called once a new node has been linked into the tree.
+     * Updates the size and the augmentation, and rebalances the tree according to the balancing policy.
+     * 
+     * @param _node Pointer to the new node.
+     * @return IteratorBoolPair Pair of an iterator to the new node and true.
+     */
+    IteratorBoolPair _after_insert(node* const _node) noexcept {
+        ++_size;
+        // a new node is the first (last) one only if it hangs on the left (right) of the former first (last) one.
+        auto parent = _node->parent;
+        if(!parent || (parent == _ends->leftmost && parent->left.get() == _node))
+            _ends->leftmost = _node;
+        if(!parent || (parent == _ends->rightmost && parent->right.get() == _node))
+            _ends->rightmost = _node;
+        _update_path(_node);
+        Balance::after_insert(*this, _node);
+        return IteratorBoolPair{iterator{_node, _last()}, true};
+    }
+    /**
+     * @brief Helper function to link a new node as a child of a given node, at a free slot.
+     * 
+     * @param parent Pointer to the parent of the new node.
+     * @param left Whether the node becomes the left child (true) or the right child (false).
+     * @param _node Pointer to the new node.
+     * @return IteratorBoolPair Pair of an iterator to the new node and true.
+     */
+    IteratorBoolPair _attach(node* const parent, const bool left, node* const _node) noexcept {
+        _node->parent = parent;
+        (left ? parent->left : parent->right).reset(_node);
+        return _after_insert(_node);
+    }
 
     /**
      * @brief Helper function to insert a node inside a BST.
      * 
      * @tparam OT
+     * @tparam Counter
      * @param pair Pair to be inserted.
+     * @param ops Cost counter of the operation, disabled when it is not to be reported.
      * @return IteratorBoolPair Returns a pair of an iterator (pointing to node) and an bool. 
      * The bool is true if a new node has been allocated, false otherwise
      * (i.e., the key was already present in the tree). 
      */
-    template <typename OT> IteratorBoolPair _insert(OT&& pair){ 
+    template <typename OT, typename Counter = op_counter> IteratorBoolPair _insert(OT&& pair, const Counter ops = {}){ 
+        return _insert_key(pair.first, [this, &pair]{ return _create_pair_node(std::forward<OT>(pair)); }, ops);
+    }
+    /**
+     * @brief Helper function reporting the cost of an operation to the diagnostics policy, if it receives
+     * it, and returning the result of the operation.
+     * 
+     * @tparam Enabled False if the operation is not to be reported.
+     * @tparam R
+     * @param op Operation.
+     * @param ops Nodes visited and comparisons of the operation.
+     * @param result Result of the operation.
+     * @return std::decay_t<R> The result.
+     */
+    template <bool Enabled, typename R>
+    std::decay_t<R> _record(const trace_operation op, const _operation_counter<Enabled>& ops, R&& result) const noexcept {
+        if constexpr (Enabled)
+            _trace.record(op, ops.nodes, ops.comparisons);
+        else
+            (void)op, (void)ops;
+        return std::forward<R>(result);
+    }
+    /**
+     * @brief Helper function to insert a node in the subtree rooted at a given node, which must be
+     * the subtree where the key belongs. Used by insert_batch(), whose descents are not reported to
+     * the diagnostics policy.
+     * 
+     * @tparam OT
+     * @param tmp Pointer to the node where the descent starts.
+     * @param pair Pair to be inserted.
+     * @return IteratorBoolPair Same as _insert().
+     */
+    template <typename OT> IteratorBoolPair _insert_below(node* tmp, OT&& pair){ 
+        return _insert_key_below(tmp, pair.first, [this, &pair]{ return _create_pair_node(std::forward<OT>(pair)); },
+                                 _operation_counter<false>{});
+    }
+    /**
+     * @brief Helper function to link a node with a given key into the BST, if the key is not present.
+     * The node is provided by a function, called only once the free slot for the key has been found,
+     * so that nothing is constructed if the key is already present.
+     * 
+     * @tparam K Type comparable with the key type.
+     * @tparam Create
+     * @param key Key of the node.
+     * @param create Function returning a pointer to the detached node to be linked.
+     * @param ops Cost of the operation so far, disabled when it is not to be reported.
+     * @return IteratorBoolPair Same as _insert().
+     */
+    template <typename K, typename Create, typename Counter = op_counter>
+    IteratorBoolPair _insert_key(const K& key, Create&& create, Counter ops = {}){
         // if BST is empty:
         if(!head.get()){ 
-            auto _node = new node{std::forward<OT>(pair)}; 
+            auto _node = create(); 
             head.reset(_node);
-            ++_size;
-            return IteratorBoolPair{iterator{_node}, true}; 
+            return _record(trace_operation::insert, ops, _after_insert(_node)); 
         }
 
         // if BST not empty:
-        auto tmp = head.get();
+        return _insert_key_below(head.get(), key, std::forward<Create>(create), ops);
+    }
+    /**
+     * @brief Helper function to link a node with a given key in the subtree rooted at a given node,
+     * which must be the subtree where the key belongs, if the key is not present.
+     * 
+     * @tparam K Type comparable with the key type.
+     * @tparam Create
+     * @param tmp Pointer to the node where the descent starts.
+     * @param key Key of the node.
+     * @param create Function returning a pointer to the detached node to be linked.
+     * @param ops Cost of the operation so far, disabled when it is not to be reported.
+     * @return IteratorBoolPair Same as _insert().
+     */
+    template <typename K, typename Create, typename Counter = op_counter>
+    IteratorBoolPair _insert_key_below(node* tmp, const K& key, Create&& create, Counter ops = {}){ 
         while(true){
-            if ( f(pair.first, tmp->pair.first) ){
+            if ( f(key, tmp->pair.first) ){
+                ops.visit(1);
                 if(tmp->left.get()){
                     tmp = tmp -> left.get();
                 }
                 else{
-                    auto _node = new node{std::forward<OT>(pair)};
-                    _node->parent = tmp;
-                    tmp->left.reset(_node);
-                    ++_size;
-                    return IteratorBoolPair{iterator{_node}, true};
+                    return _record(trace_operation::insert, ops, _attach(tmp, true, create()));
                 }
             }
-            else if( f(tmp->pair.first, pair.first) ){
+            else if( f(tmp->pair.first, key) ){
+                ops.visit(2);
                 if(tmp->right.get()){
                     tmp = tmp -> right.get();
                 }
                 else{
-                    auto _node = new node{std::forward<OT>(pair)};
-                    _node->parent = tmp;
-                    tmp->right.reset(_node);
-                    ++_size;
-                    return IteratorBoolPair{iterator{_node}, true};
+                    return _record(trace_operation::insert, ops, _attach(tmp, false, create()));
                 }
             }
             else {
-                return IteratorBoolPair{iterator{tmp}, false};
+                ops.visit(2);
+                return _record(trace_operation::insert, ops, IteratorBoolPair{iterator{tmp, _last()}, false});
+            }
+        }
+    }
+    /**
+     * @brief Helper function to link a node with a given key into the BST, if the key is not present,
+     * starting from a hint: if the key belongs right before the hint (or right after it), the node is
+     * linked there without descending from the root, which takes amortized O(1) when the keys come
+     * sorted or nearly sorted. Otherwise, the key is inserted as usual.
+     * 
+     * @tparam K Type comparable with the key type.
+     * @tparam Create
+     * @param hint Pointer to the node the key should be inserted before, nullptr for the end.
+     * @param key Key of the node.
+     * @param create Function returning a pointer to the detached node to be linked.
+     * @return IteratorBoolPair Same as _insert().
+     */
+    template <typename K, typename Create> IteratorBoolPair _insert_key_hint(node* const hint, const K& key, Create&& create){
+        if(!head.get())
+            return _insert_key(key, std::forward<Create>(create));
+        op_counter ops;
+        if(!hint || f(key, hint->pair.first)){
+            if(hint)
+                ops.visit(1);
+            // the predecessor of the hint (the rightmost node for the end) has no right child if
+            // the hint has a left child, so the key hangs on either of them.
+            auto before = hint ? iterator::prev(hint) : *_last();
+            if(before)
+                ops.visit(1);
+            if(!before || f(before->pair.first, key))
+                return _record(trace_operation::insert, ops,
+                               hint && !hint->left.get() ? _attach(hint, true, create()) : _attach(before, false, create()));
+        }
+        else if(f(hint->pair.first, key)){
+            ops.visit(2);
+            // mirrored: the key belongs right after the hint.
+            auto after = iterator::next(hint);
+            if(after)
+                ops.visit(1);
+            if(!after || f(key, after->pair.first))
+                return _record(trace_operation::insert, ops,
+                               !hint->right.get() ? _attach(hint, false, create()) : _attach(after, true, create()));
+        }
+        else{
+            ops.visit(2);
+            return _record(trace_operation::insert, ops, IteratorBoolPair{iterator{hint, _last()}, false});
+        }
+        // wrong hint.
+        return _insert_key(key, std::forward<Create>(create), ops);
+    }
+    /**
+     * @brief Helper function to create a node whose pair is constructed in place, from a key and the
+     * arguments of the constructor of the value.
+     * 
+     * @tparam OT
+     * @tparam Types
+     * @param key Key of the pair.
+     * @param args Arguments forwarded to the constructor of the value.
+     * @return node* Pointer to the new node.
+     */
+    template <typename OT, typename ... Types> node* _create_emplaced_node(OT&& key, Types&& ... args){
+        return _create_node(std::in_place, std::piecewise_construct, std::forward_as_tuple(std::forward<OT>(key)),
+                            std::forward_as_tuple(std::forward<Types>(args)...));
+    }
+    /**
+     * @brief Helper function to implement try_emplace() and emplace() of a key and a value. The pair is
+     * constructed only if the key is not present.
+     * 
+     * @tparam OT
+     * @tparam Types
+     * @param hint Pointer to the node the key should be inserted before (nullptr for the end), or
+     * std::nullopt to descend from the root.
+     * @param key Key of the pair.
+     * @param args Arguments forwarded to the constructor of the value.
+     * @return IteratorBoolPair Same as _insert().
+     */
+    template <typename OT, typename ... Types>
+    IteratorBoolPair _try_emplace(const std::optional<node*> hint, OT&& key, Types&& ... args){
+        const auto create = [&]{ return _create_emplaced_node(std::forward<OT>(key), std::forward<Types>(args)...); };
+        return hint ? _insert_key_hint(*hint, key, create) : _insert_key(key, create);
+    }
+    /**
+     * @brief Helper function to implement emplace() and emplace_hint(). The pair is constructed in the
+     * node from the arguments, without any temporary, unless they are a key and a value: then it is
+     * constructed only if the key is not present.
+     * 
+     * @tparam Types
+     * @param hint Same as _try_emplace().
+     * @param args Arguments forwarded to the constructor of the pair.
+     * @return IteratorBoolPair Same as _insert().
+     */
+    template <typename ... Types> IteratorBoolPair _emplace(const std::optional<node*> hint, Types&& ... args){
+        if constexpr (_is_key_value<KT, Types...>::value)
+            return _try_emplace(hint, std::forward<Types>(args)...);
+        else{
+            auto _node = _create_node(std::in_place, std::forward<Types>(args)...);
+            try{
+                const auto create = [_node]{ return _node; };
+                auto result = hint ? _insert_key_hint(*hint, _node->pair.first, create) : _insert_key(_node->pair.first, create);
+                if(!result.second)
+                    _destroy_node(_node);
+                return result;
+            }
+            catch(...){
+                _destroy_node(_node);
+                throw;
             }
         }
     }
+    /**
+     * @brief Helper function to implement assign() and insert_or_assign(). Assigns a value to the one of
+     * a node and updates the augmentation of the node and of its ancestors.
+     * 
+     * @tparam M
+     * @param _node Pointer to the node.
+     * @param value Value to be assigned.
+     */
+    template <typename M> void _assign(node* const _node, M&& value){
+        _node->pair.second = std::forward<M>(value);
+        _update_path(_node);
+    }
     /**
      * @brief Helper function to implement overload of operator[]. Returns a reference to 
      * the value that is mapped to a key equivalent to x, performing an insertion if 
-     * such key does not already exist. In this case, a default value of value type is 
-     * when inserting the pair. 
+     * such key does not already exist. In this case, the value is value-initialized in
+     * the new node, and no pair is constructed if the key is present. 
      * 
      * @tparam OT
      * @param key The key we want to find BST. 
      * @return VT& Reference to value type. 
      */
     template <typename OT> VT& _sub(OT&& key){ 
-        return insert(PairType{std::forward<OT>(key),{}}).first->second;
+        static_assert(!_readonly_values, "The values are cached by the augmentation: use update() or insert_or_assign().");
+        return _try_emplace(std::nullopt, std::forward<OT>(key)).first->second;
     }
     /**
      * @brief Helper function to implement find() and cfind().
@@ -102,44 +560,353 @@ class BST{
      * 
      * @tparam OT
      * @param key Key we want to find in the tree.
+     * @param op Operation the cost of the lookup is reported as.
      * @return node* Pointer to node.
      */
-    template <typename OT> node* _find(OT&& key) const noexcept {
+    template <typename OT> node* _find(OT&& key, const trace_operation op = trace_operation::find) const noexcept {
+        op_counter ops;
         if(!head.get()){
-            std::cout<<"BST is empty."<<std::endl;
-            return nullptr;
+            _trace.record(trace_event::find_on_empty);
+            return _record(op, ops, nullptr);
         }
         auto tmp = head.get();
         while(true){
             if ( f(std::forward<OT>(key), tmp->pair.first)){
+                ops.visit(1);
                 if(tmp->left.get())
                     tmp = tmp -> left.get();
                 else{
-                    return nullptr;
+                    return _record(op, ops, nullptr);
                 }
             }
             else if ( f(tmp->pair.first, std::forward<OT>(key)) ) {
+                ops.visit(2);
                 if(tmp->right.get())
                     tmp = tmp -> right.get();
                 else{
-                    return nullptr;
+                    return _record(op, ops, nullptr);
+                }
+            }
+            else{
+                ops.visit(2);
+                return _record(op, ops, tmp);
+            }
+        }
+    }
+    /**
+     * @brief Helper function to hint the processor that a node will be needed soon. Does nothing if
+     * the compiler has no prefetch builtin.
+     * 
+     * @param _node Pointer to node (nullptr is allowed).
+     */
+    static void _prefetch(const node* const _node) noexcept {
+#if defined(__GNUC__)
+        __builtin_prefetch(_node);
+#else
+        (void)_node;
+#endif
+    }
+    /**
+     * @brief Helper function running the descents of a group of keys interleaved: every round moves
+     * each search in flight down by one level and prefetches the node it will visit in the next round,
+     * so that the cache misses of the different searches overlap instead of being paid one after the other.
+     * 
+     * @tparam It Forward iterator.
+     * @tparam Key Function returning the key of an element of the group.
+     * @param first Iterator to the first element of the group.
+     * @param count Number of elements of the group, at most _batch_width.
+     * @param key Function returning the key of an element.
+     * @param nodes For every element, the node with its key if found, otherwise the last node visited
+     * (nullptr if the tree is empty).
+     * @param found For every element, true if its key is in the tree.
+     */
+    template <typename It, typename Key>
+    void _descend_group(const It first, const std::size_t count, Key key, node** const nodes, bool* const found) const noexcept {
+        node* cursors[_batch_width];
+        for(std::size_t i = 0; i < count; ++i){
+            cursors[i] = nodes[i] = head.get();
+            found[i] = false;
+        }
+        for(bool pending = head != nullptr; pending; ){
+            pending = false;
+            auto it = first;
+            for(std::size_t i = 0; i < count; ++i, ++it){
+                auto tmp = cursors[i];
+                if(!tmp)
+                    continue;
+                nodes[i] = tmp;
+                if(f(key(*it), tmp->pair.first))
+                    tmp = tmp->left.get();
+                else if(f(tmp->pair.first, key(*it)))
+                    tmp = tmp->right.get();
+                else{
+                    found[i] = true;
+                    tmp = nullptr;
+                }
+                if(tmp){
+                    _prefetch(tmp);
+                    pending = true;
                 }
+                cursors[i] = tmp;
+            }
+        }
+    }
+    /**
+     * @brief Helper function to implement find_batch(). The keys are looked up in groups of
+     * _batch_width interleaved descents.
+     * 
+     * @tparam I Type of the output iterators.
+     * @tparam It Forward iterator to keys.
+     * @tparam Out Output iterator.
+     */
+    template <typename I, typename It, typename Out> Out _find_batch(It first, const It last, Out out) const noexcept {
+        node* nodes[_batch_width];
+        bool found[_batch_width];
+        while(first != last){
+            auto group = first;
+            std::size_t count = 0;
+            for(; first != last && count < _batch_width; ++first)
+                ++count;
+            for(std::size_t i = 0; !head && i < count; ++i){
+                _trace.record(trace_event::find_on_empty);
+            }
+            _descend_group(group, count, [](const auto& key) -> const auto& { return key; }, nodes, found);
+            for(std::size_t i = 0; i < count; ++i)
+                *out++ = I{found[i] ? nodes[i] : nullptr, _last()};
+        }
+        return out;
+    }
+    /**
+     * @brief Helper function returning the unique pointer which owns a node, i.e., the left or right
+     * child of its parent or the head of the BST if the node is the root.
+     * 
+     * @param x Pointer to node.
+     * @return link& Reference to the owner of the node.
+     */
+    link& _owner_of(node* const x) noexcept {
+        if(!x->parent)
+            return head;
+        return x->parent->left.get() == x ? x->parent->left : x->parent->right;
+    }
+    /**
+     * @brief Helper function to rotate the subtree rooted at x to the left. The right child of x
+     * takes the place of x, and x becomes its left child. Used by the balancing policies.
+     * 
+     * @param x Pointer to node. Must have a right child.
+     * @return node* Pointer to the new root of the subtree.
+     */
+    node* _rotate_left(node* const x) noexcept {
+        auto& owner = _owner_of(x);
+        auto y = x->right.release();
+        owner.release();
+        x->right.reset(y->left.release());
+        if(x->right)
+            x->right->parent = x;
+        y->parent = x->parent;
+        y->left.reset(x);
+        x->parent = y;
+        owner.reset(y);
+        _update(x);
+        _update(y);
+        return y;
+    }
+    /**
+     * @brief Helper function to rotate the subtree rooted at x to the right. The left child of x
+     * takes the place of x, and x becomes its right child. Used by the balancing policies.
+     * 
+     * @param x Pointer to node. Must have a left child.
+     * @return node* Pointer to the new root of the subtree.
+     */
+    node* _rotate_right(node* const x) noexcept {
+        auto& owner = _owner_of(x);
+        auto y = x->left.release();
+        owner.release();
+        x->left.reset(y->right.release());
+        if(x->left)
+            x->left->parent = x;
+        y->parent = x->parent;
+        y->right.reset(x);
+        x->parent = y;
+        owner.reset(y);
+        _update(x);
+        _update(y);
+        return y;
+    }
+    /**
+     * @brief Helper function to implement lower_bound(). Same descent as _find(), remembering the last
+     * node whose key is not less than the given key.
+     * 
+     * @tparam OT
+     * @param key Key to be compared.
+     * @return node* Pointer to the first node whose key is not less than key, nullptr if there is none.
+     */
+    template <typename OT> node* _lower_bound(const OT& key) const noexcept {
+        node* bound = nullptr;
+        auto tmp = head.get();
+        while(tmp){
+            if(!f(tmp->pair.first, key)){
+                bound = tmp;
+                tmp = tmp->left.get();
+            }
+            else{
+                tmp = tmp->right.get();
+            }
+        }
+        return bound;
+    }
+    /**
+     * @brief Helper function to implement upper_bound(). Same descent as _find(), remembering the last
+     * node whose key is greater than the given key.
+     * 
+     * @tparam OT
+     * @param key Key to be compared.
+     * @return node* Pointer to the first node whose key is greater than key, nullptr if there is none.
+     */
+    template <typename OT> node* _upper_bound(const OT& key) const noexcept {
+        node* bound = nullptr;
+        auto tmp = head.get();
+        while(tmp){
+            if(f(key, tmp->pair.first)){
+                bound = tmp;
+                tmp = tmp->left.get();
             }
             else{
-                return tmp;
+                tmp = tmp->right.get();
             }
         }
+        return bound;
     }
     /**
-     * @brief Helper function to delete a leaf node. Used only for the purpose of erasing
-     * a node.
+     * @brief Helper function to implement equal_range(). The range is [node, successor) if the key is
+     * present, and the empty range at the lower bound otherwise.
+     * 
+     * @tparam OT
+     * @param key Key to be found.
+     * @return std::pair<node*, node*> Pointers to the first node of the range and to one-past the last.
+     */
+    template <typename OT> std::pair<node*, node*> _equal_range(const OT& key) const noexcept {
+        auto bound = _lower_bound(key);
+        if(bound && !f(key, bound->pair.first)){
+            return {bound, iterator::next(bound)};
+        }
+        return {bound, bound};
+    }
+    /**
+     * @brief Helper function to implement range(). Returns the bounds of the keys in [low, high), or an
+     * empty range if high is not greater than low.
+     * 
+     * @tparam OT1
+     * @tparam OT2
+     * @param low Lower bound, included.
+     * @param high Upper bound, excluded.
+     * @return std::pair<node*, node*> Pointers to the first node of the range and to one-past the last.
+     */
+    template <typename OT1, typename OT2> std::pair<node*, node*> _range(const OT1& low, const OT2& high) const noexcept {
+        if(!f(low, high)){
+            return {nullptr, nullptr};
+        }
+        return {_lower_bound(low), _lower_bound(high)};
+    }
+    /**
+     * @brief Helper function to implement rank(). Same descent as _lower_bound(), adding up the sizes of
+     * the left subtrees skipped when moving right.
+     * 
+     * @tparam OT
+     * @param key Key to be compared.
+     * @return std::size_t Number of keys less than key.
+     */
+    template <typename OT> std::size_t _rank(const OT& key) const noexcept {
+        static_assert(_has_subtree_size<node>::value, "rank() requires the order_statistics augmentation.");
+        std::size_t rank = 0;
+        auto tmp = head.get();
+        while(tmp){
+            if(f(tmp->pair.first, key)){
+                rank += order_statistics::size(tmp->left.get()) + 1;
+                tmp = tmp->right.get();
+            }
+            else{
+                tmp = tmp->left.get();
+            }
+        }
+        return rank;
+    }
+    /**
+     * @brief Helper function to implement count_in_range().
+     * 
+     * @tparam OT1
+     * @tparam OT2
+     * @param low Lower bound, included.
+     * @param high Upper bound, excluded.
+     * @return std::size_t Number of keys in [low, high).
+     */
+    template <typename OT1, typename OT2> std::size_t _count_in_range(const OT1& low, const OT2& high) const noexcept {
+        if(!f(low, high)){
+            return 0;
+        }
+        return _rank(high) - _rank(low);
+    }
+    /**
+     * @brief Helper function to implement aggregate(). Finds the topmost node within [low, high), where the
+     * paths to the two bounds split. Then, walking down towards low, every node not less than low is
+     * combined with the cached aggregate of its right subtree, and, walking down towards high, every node
+     * less than high is combined with the cached aggregate of its left subtree.
+     * 
+     * @tparam OT1
+     * @tparam OT2
+     * @param low Lower bound, included.
+     * @param high Upper bound, excluded.
+     * @return Combination, in order, of the values of the keys in [low, high).
+     */
+    template <typename OT1, typename OT2> auto _aggregate(const OT1& low, const OT2& high) const {
+        auto split = head.get();
+        if(!f(low, high)){
+            split = nullptr;
+        }
+        while(split){
+            if(f(split->pair.first, low))
+                split = split->right.get();
+            else if(!f(split->pair.first, high))
+                split = split->left.get();
+            else
+                break;
+        }
+        if(!split){
+            return Augment::identity();
+        }
+        auto left_part = Augment::identity();
+        for(auto tmp = split->left.get(); tmp; ){
+            if(!f(tmp->pair.first, low)){
+                left_part = Augment::combine(Augment::combine(tmp->pair.second, Augment::summary(tmp->right.get())), left_part);
+                tmp = tmp->left.get();
+            }
+            else{
+                tmp = tmp->right.get();
+            }
+        }
+        auto right_part = Augment::identity();
+        for(auto tmp = split->right.get(); tmp; ){
+            if(f(tmp->pair.first, high)){
+                right_part = Augment::combine(right_part, Augment::combine(Augment::summary(tmp->left.get()), tmp->pair.second));
+                tmp = tmp->right.get();
+            }
+            else{
+                tmp = tmp->left.get();
+            }
+        }
+        return Augment::combine(Augment::combine(left_part, split->pair.second), right_part);
+    }
+    /**
+     * @brief Helper function to unlink a leaf node from the BST, without freeing it. Used for the
+     * purpose of erasing or extracting a node.
      * 
      * @param leaf Pointer to leaf node.
      */
-    void delete_leaf(node *const leaf) noexcept {
+    void unlink_leaf(node *const leaf) noexcept {
         auto parent = leaf->parent;
         leaf->parent = nullptr;
-        if(parent->left.get() == leaf)
+        if(!parent)
+            head.reset(nullptr);
+        else if(parent->left.get() == leaf)
             parent->left.reset(nullptr);   
         else
             parent->right.reset(nullptr);
@@ -205,6 +972,9 @@ class BST{
         left_node_of_node1->parent = node2;
 
         node2->parent = parent_of_node1;
+        // node2 now sits where node1 was and vice versa, hence they exchange the data of the
+        // policies as well.
+        std::swap(static_cast<node_data&>(*node1), static_cast<node_data&>(*node2));
         // if parent of node 1 is nullptr then node1 is the root node. Therefore we must 
         // reset the head from node1 to node2.
         if(parent_of_node1){
@@ -224,12 +994,12 @@ class BST{
 
     }
     /**
-     * @brief Helper function to delete a node with one child. Used solely for the purpose of erasing
-     * a node.
+     * @brief Helper function to unlink a node with one child from the BST, without freeing it. The
+     * child takes its place. Used for the purpose of erasing or extracting a node.
      * 
      * @param node1 Pointer to node.
      */
-    void delete_node_with_one_child(node* const node1) noexcept{
+    void unlink_node_with_one_child(node* const node1) noexcept{
         auto parent_of_node1 = node1->parent;
         node1->parent = nullptr;
         node* child_of_node1;
@@ -241,7 +1011,9 @@ class BST{
             child_of_node1 = node1->right.release();
             child_of_node1->parent = parent_of_node1;
         }
-        if(parent_of_node1->left.get() == node1)
+        if(!parent_of_node1)
+            head.reset(child_of_node1);
+        else if(parent_of_node1->left.get() == node1)
             parent_of_node1->left.reset(child_of_node1);   
         else
             parent_of_node1->right.reset(child_of_node1);
@@ -256,117 +1028,1201 @@ class BST{
      * @param key Key to be erased.
      */
     template <typename O> void _erase(O&&key) noexcept {
-        auto _node = _find(std::forward<O>(key));
+        auto _node = _find(std::forward<O>(key), trace_operation::erase);
         if (!_node){ 
-            std::cout<<"Erase failed. This key does not exist."<<std::endl;
+            _trace.record(trace_event::erase_missing);
             return;
         }
-        if(!_node->left && !_node->right){
-            delete_leaf(_node);
-            return;
+        _destroy_node(_unlink(_node));
+    }
+    /**
+     * @brief Helper function for unlinking a node from the BST without freeing it, keeping the tree
+     * balanced. The node is left detached, with the data of a new node.
+     * 
+     * @param _node Pointer to the node.
+     * @return node* Pointer to the node.
+     */
+    node* _unlink(node* const _node) noexcept {
+        if(_node == _ends->leftmost)
+            _ends->leftmost = iterator::next(_node);
+        if(_node == _ends->rightmost)
+            _ends->rightmost = iterator::prev(_node);
+        if(_node->left && _node->right){
+            //successor can have either no children (leaf) or only right child.
+            swap_with_successor_of_node_with_two_children(_node, iterator::next(_node));
+            // the subtrees between the two swapped positions now contain _node in place of its successor.
+            _update_path(_node);
         }
-        else if(_node->left && _node->right){
-            auto _node_pred = _node;
-            _node = iterator::next(_node); //successor can have either no children (leaf) or only right child.
-
-            if(!_node->right.get()){
-                //successor has no children and is leaf node
-                swap_with_successor_of_node_with_two_children(_node_pred, _node);
-                delete_leaf(_node_pred);
-            }
-            else{
-                // successor has a right child
-                swap_with_successor_of_node_with_two_children(_node_pred,_node);
-                delete_node_with_one_child(_node_pred);
-            }
+        // _node has now at most one child.
+        Balance::before_unlink(*this, _node);
+        auto parent = _node->parent;
+        if(!_node->left && !_node->right){
+            unlink_leaf(_node);
         }
         else{
-            if(_node->right){
-                delete_node_with_one_child(_node);
-            }
-            else{
-                delete_node_with_one_child(_node);
-            }
-            return;
-        }       
+            unlink_node_with_one_child(_node);
+        }
+        _update_path(parent);
+        Balance::after_unlink(*this, parent);
+        static_cast<node_data&>(*_node) = node_data{};
+        return _node;
     }
         
     /**
-     * @brief Helper function which takes a sorted vector of pairs, and recursively inserts the median located
-     * between @param start and @param end of the vector into the BST. 
+     * @brief Helper function which takes a list of n nodes sorted in descending order and linked through
+     * their left child, and links them into a perfectly balanced subtree. The median is the root, the
+     * first half of the list builds the right subtree and the second half the left subtree.
+     * The data of the balancing policy is set once the children of a node have been built.
      * 
-     * @param vector_of_pairs sorted vector of pairs to be inserted into the BST
-     * @param start start of vector from where median should be calculated.
-     * @param end end of vector from where median should be calculated. 
+     * @param list Reference to the head of the list. On return, it points to the first node not used.
+     * @param n Number of nodes of the subtree.
+     * @param depth Depth of the root of the subtree.
+     * @param max_depth Depth of the deepest node of the whole tree.
+     * @return node* Pointer to the root of the subtree.
      */
-    void _insert_medians(const std::vector<PairType>& vector_of_pairs, const int start, const int end){
-        if(start > end){
-            return;
+    node* _link_medians(node*& list, const std::size_t n, const std::size_t depth, const std::size_t max_depth) noexcept {
+        if(!n){
+            return nullptr;
         }
-        auto mid = (end+start)/2;
+        auto right = _link_medians(list, n/2, depth+1, max_depth);
+        auto median = list;
+        list = median->left.release();
+        auto left = _link_medians(list, n - n/2 - 1, depth+1, max_depth);
 
-        insert(vector_of_pairs[mid]);
-
-        _insert_medians(vector_of_pairs, start, mid-1);
-        _insert_medians(vector_of_pairs, mid+1, end);
+        median->right.release();
+        median->right.reset(right);
+        if(right)
+            right->parent = median;
+        median->left.reset(left);
+        if(left)
+            left->parent = median;
+        Balance::after_build(median, depth, max_depth);
+        Augment::update(median);
+        return median;
     }
     /**
-     * @brief Helper function to get the leftmost node of the BST.
-     * 
-     * @return pointer to node.
+     * @brief Helper function to rebuild the tree into a perfectly balanced shape in O(n), relinking the
+     * existing nodes: no node is allocated, copied or freed.
+     * The nodes are first threaded in descending order through their left child while visiting the tree
+     * in order (the successor of a node never looks at its left child nor at the left child of the
+     * nodes already visited), then the list is linked back into a tree by _link_medians().
      */
-    auto _leftmost_node() const noexcept {
-        auto tmp = head.get();
-        while (tmp->left)
-            tmp = tmp->left.get();
-        return tmp;
-    }
+    void _rebuild() noexcept {
+        if(!head){
+            return;
+        }
+        node* list = nullptr;
+        for(auto tmp = _first(); tmp; ){
+            auto successor = iterator::next(tmp);
+            tmp->left.release();
+            tmp->left.reset(list);
+            list = tmp;
+            tmp = successor;
+        }
+        std::size_t max_depth = 0;
+        while((_size >> (max_depth + 1)) != 0){
+            ++max_depth;
+        }
+        head.release();
+        head.reset(_link_medians(list, _size, 0, max_depth));
+        head->parent = nullptr;
+    }
+    /**
+     * @brief Helper function to fill an empty tree from a range of pairs sorted by key. The nodes are
+     * appended to a right vine (a valid, degenerate, BST), which is then balanced in O(n) by _rebuild().
+     * Duplicated keys are skipped, keeping the first pair like insert() does. If the range turns out
+     * not to be sorted, the remaining pairs are inserted one by one.
+     * 
+     * @tparam It Input iterator to pairs.
+     * @param first Iterator to the first pair.
+     * @param last Iterator to one-past the last pair.
+     */
+    template <typename It> void _build_from_sorted(It first, It last){
+        node* tail = nullptr;
+        for(; first != last; ++first){
+            auto&& pair = *first;
+            if(tail && !f(tail->pair.first, pair.first)){
+                if(f(pair.first, tail->pair.first)){
+                    break;
+                }
+                continue;
+            }
+            auto _node = _create_pair_node(std::forward<decltype(pair)>(pair));
+            if(tail){
+                _node->parent = tail;
+                tail->right.reset(_node);
+            }
+            else{
+                head.reset(_node);
+            }
+            tail = _node;
+            ++_size;
+        }
+        _set_extremes(head.get(), tail);
+        _rebuild();
+        for(; first != last; ++first){
+            insert(*first);
+        }
+    }
+    /**
+     * @brief Helper function to recompute the first and the last node of the BST, descending from the root.
+     * 
+     */
+    void _reset_extremes() noexcept {
+        auto leftmost = head.get();
+        auto rightmost = head.get();
+        if(head){
+            while (leftmost->left)
+                leftmost = leftmost->left.get();
+            while (rightmost->right)
+                rightmost = rightmost->right.get();
+        }
+        _set_extremes(leftmost, rightmost);
+    }
+
+    /**
+     * @brief Helper function to copy the top levels of a subtree, down to depth fork_depth, collecting
+     * the pairs of nodes whose children are still to be copied.
+     * 
+     * @param from Pointer to the node to be copied.
+     * @param to Pointer to the copy of the node, without children.
+     * @param depth Depth of the node.
+     * @param fork_depth Depth of the nodes whose children are copied by independent tasks.
+     * @param frontier Vector of the pairs (node, copy) at depth fork_depth.
+     */
+    void _copy_top(const node* const from, node* const to, const std::size_t depth, const std::size_t fork_depth,
+                   std::vector<std::pair<const node*, node*>>& frontier){
+        if(depth == fork_depth){
+            frontier.emplace_back(from, to);
+            return;
+        }
+        if(from->left){
+            to->left.reset(_create_node(*from->left, to));
+            _copy_top(from->left.get(), to->left.get(), depth + 1, fork_depth, frontier);
+        }
+        if(from->right){
+            to->right.reset(_create_node(*from->right, to));
+            _copy_top(from->right.get(), to->right.get(), depth + 1, fork_depth, frontier);
+        }
+    }
+    /**
+     * @brief Helper function to copy the subtrees of a node on several threads: the top levels are
+     * copied by the calling thread, then the subtrees below them by independent tasks. Every node is
+     * linked as soon as it is created, so that the copy can be cleared if an allocation fails.
+     * 
+     * @param root Pointer to the node to be copied.
+     * @param root_copy Pointer to the copy of the node, without children.
+     * @param threads Number of threads.
+     */
+    void _copy_children(const node* const root, node* const root_copy, const std::size_t threads){
+        if(threads < 2 || !_concurrent_allocator<node_allocator>::value){
+            _copy_children(root, root_copy);
+            return;
+        }
+        std::vector<std::pair<const node*, node*>> frontier;
+        _copy_top(root, root_copy, 0, _fork_depth(threads), frontier);
+        _parallel_for(frontier.size(), threads, [&](const std::size_t i){
+            _copy_children(frontier[i].first, frontier[i].second);
+        });
+    }
+
+    /**
+     * @brief Helper function to split the top levels of a subtree into pieces which can be visited
+     * independently: the subtrees rooted at depth fork_depth, and the single nodes above them.
+     * The pieces are collected in order.
+     * 
+     * @param _node Pointer to the root of the subtree.
+     * @param depth Depth of the node.
+     * @param fork_depth Depth of the roots of the whole subtrees.
+     * @param pieces Vector of pairs of the root of a piece and true if the piece is its whole subtree.
+     */
+    static void _split(node* const _node, const std::size_t depth, const std::size_t fork_depth,
+                       std::vector<std::pair<node*, bool>>& pieces){
+        if(!_node)
+            return;
+        if(depth == fork_depth){
+            pieces.emplace_back(_node, true);
+            return;
+        }
+        _split(_node->left.get(), depth + 1, fork_depth, pieces);
+        pieces.emplace_back(_node, false);
+        _split(_node->right.get(), depth + 1, fork_depth, pieces);
+    }
+    /**
+     * @brief Helper function to call a function on every node of a piece built by _split(), in order.
+     * 
+     * @param piece Pair of the root of the piece and true if the piece is its whole subtree.
+     * @param function Function called with a pointer to every node.
+     */
+    template <typename Function> static void _visit_piece(const std::pair<node*, bool>& piece, Function&& function){
+        if(!piece.second){
+            function(piece.first);
+            return;
+        }
+        auto first = piece.first;
+        while(first->left)
+            first = first->left.get();
+        auto last = piece.first;
+        while(last->right)
+            last = last->right.get();
+        const auto stop = iterator::next(last);
+        for(auto _node = first; _node != stop; _node = iterator::next(_node))
+            function(_node);
+    }
+    /**
+     * @brief Helper function to call a function on every node of the tree, on several threads, in no
+     * particular order.
+     * 
+     * @param function Function called with a pointer to every node.
+     * @param threads Number of threads.
+     */
+    template <typename Function> void _parallel_visit(Function&& function, const std::size_t threads) const {
+        if(threads < 2 || _size < _parallel_grain){
+            for(auto _node = _first(); _node; _node = iterator::next(_node))
+                function(_node);
+            return;
+        }
+        std::vector<std::pair<node*, bool>> pieces;
+        _split(head.get(), 0, _fork_depth(threads), pieces);
+        _parallel_for(pieces.size(), threads, [&](const std::size_t i){ _visit_piece(pieces[i], function); });
+    }
+
+    /**
+     * @brief Helper function which links n nodes sorted in ascending order into a perfectly balanced
+     * subtree, with the same shape as _link_medians(). The subtrees whose root is at depth fork_depth
+     * must be linked already: only their root is returned.
+     * 
+     * @param nodes Pointer to the first node.
+     * @param n Number of nodes of the subtree.
+     * @param depth Depth of the root of the subtree.
+     * @param max_depth Depth of the deepest node of the whole tree.
+     * @param fork_depth Depth of the subtrees linked already.
+     * @return node* Pointer to the root of the subtree.
+     */
+    node* _link_sorted(node* const* const nodes, const std::size_t n, const std::size_t depth,
+                       const std::size_t max_depth, const std::size_t fork_depth) noexcept {
+        if(!n){
+            return nullptr;
+        }
+        const auto m = n - n/2 - 1;
+        const auto median = nodes[m];
+        if(depth == fork_depth){
+            return median;
+        }
+        auto left = _link_sorted(nodes, m, depth+1, max_depth, fork_depth);
+        auto right = _link_sorted(nodes + m + 1, n/2, depth+1, max_depth, fork_depth);
+
+        median->left.release();
+        median->left.reset(left);
+        if(left)
+            left->parent = median;
+        median->right.release();
+        median->right.reset(right);
+        if(right)
+            right->parent = median;
+        Balance::after_build(median, depth, max_depth);
+        Augment::update(median);
+        return median;
+    }
+    /**
+     * @brief Helper function to link all the nodes, sorted in ascending order, into a perfectly
+     * balanced tree on several threads: the subtrees rooted at the fork depth are independent tasks,
+     * and the levels above them are linked by the calling thread once they are done.
+     * 
+     * @param nodes Vector of the nodes, sorted in ascending order. Its size is _size.
+     * @param threads Number of threads.
+     */
+    void _link_all(const std::vector<node*>& nodes, const std::size_t threads){
+        std::size_t max_depth = 0;
+        while((_size >> (max_depth + 1)) != 0){
+            ++max_depth;
+        }
+        const auto fork_depth = std::min(_fork_depth(threads), max_depth);
+        // the i-th subtree at the fork depth is reached following the bits of i, from the most significant.
+        _parallel_for(std::size_t{1} << fork_depth, threads, [&](const std::size_t i){
+            std::size_t first = 0, n = _size;
+            for(auto level = fork_depth; level-- > 0; ){
+                const auto m = n - n/2 - 1;
+                if((i >> level) & 1){
+                    first += m + 1;
+                    n = n/2;
+                }
+                else{
+                    n = m;
+                }
+            }
+            _link_sorted(nodes.data() + first, n, fork_depth, max_depth, max_depth + 1);
+        });
+        head.release();
+        head.reset(_link_sorted(nodes.data(), _size, 0, max_depth, fork_depth));
+        head->parent = nullptr;
+        _set_extremes(nodes.front(), nodes.back());
+    }
+    /**
+     * @brief Helper function to rebuild the tree into a perfectly balanced shape on several threads.
+     * The nodes are gathered in order into a vector, each piece of the top of the tree by its own task,
+     * and then linked by _link_all(). No node is allocated, copied or freed.
+     * 
+     * @param threads Number of threads.
+     */
+    void _rebuild(const std::size_t threads){
+        if(threads < 2 || _size < _parallel_grain){
+            _rebuild();
+            return;
+        }
+        std::vector<std::pair<node*, bool>> pieces;
+        _split(head.get(), 0, _fork_depth(threads), pieces);
+        // offsets[i] is the position in order of the first node of the i-th piece.
+        std::vector<std::size_t> offsets(pieces.size() + 1, 0);
+        std::vector<node*> nodes(_size);
+        _parallel_for(pieces.size(), threads, [&](const std::size_t i){
+            _visit_piece(pieces[i], [&](node*){ ++offsets[i + 1]; });
+        });
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        _parallel_for(pieces.size(), threads, [&](const std::size_t i){
+            auto position = offsets[i];
+            _visit_piece(pieces[i], [&](node* const _node){ nodes[position++] = _node; });
+        });
+        _link_all(nodes, threads);
+    }
+    /**
+     * @brief Helper function to fill an empty tree from a random-access range of pairs sorted by key,
+     * on several threads: the order is checked and the nodes are created by independent tasks, then
+     * linked by _link_all(). If the range is not strictly increasing, falls back to _build_from_sorted().
+     * 
+     * @tparam It Random access iterator to pairs.
+     * @param first Iterator to the first pair.
+     * @param last Iterator to one-past the last pair.
+     * @param threads Number of threads.
+     */
+    template <typename It> void _build_from_sorted(It first, It last, const std::size_t threads){
+        const auto n = static_cast<std::size_t>(last - first);
+        if(threads < 2 || n < _parallel_grain){
+            _build_from_sorted(first, last);
+            return;
+        }
+        const auto chunks = 8*threads;
+        std::atomic<bool> sorted{true};
+        _parallel_for(chunks, threads, [&](const std::size_t c){
+            for(auto i = std::max<std::size_t>(c*n/chunks, 1); i < (c+1)*n/chunks && sorted; ++i){
+                if(!f(first[i-1].first, first[i].first))
+                    sorted = false;
+            }
+        });
+        if(!sorted){
+            _build_from_sorted(first, last);
+            return;
+        }
+        std::vector<node*> nodes(n, nullptr);
+        // the tasks only read the header.
+        _ensure_header();
+        try{
+            _parallel_for(chunks, _concurrent_allocator<node_allocator>::value ? threads : 1, [&](const std::size_t c){
+                for(auto i = c*n/chunks; i < (c+1)*n/chunks; ++i)
+                    nodes[i] = _create_node(std::forward<decltype(first[i])>(first[i]));
+            });
+        }
+        catch(...){
+            for(const auto _node: nodes){
+                if(_node)
+                    _destroy_node(_node);
+            }
+            throw;
+        }
+        using reference = decltype(*first);
+        for(std::size_t i = 0; i < n; ++i)
+            _trace.record(std::is_lvalue_reference<reference>::value ? trace_event::lvalue_node_ctor : trace_event::rvalue_node_ctor);
+        _size = n;
+        _link_all(nodes, threads);
+    }
+
+    /**
+     * @brief Helper function to link a detached node k with two detached (possibly empty) subtrees as
+     * its children. k becomes a detached root, and its data is recomputed. Used by the balancing policies.
+     * 
+     * @param k Pointer to node.
+     * @param l Pointer to the root of the left subtree.
+     * @param r Pointer to the root of the right subtree.
+     */
+    void _link(node* const k, node* const l, node* const r) noexcept {
+        k->left.release();
+        k->left.reset(l);
+        if(l)
+            l->parent = k;
+        k->right.release();
+        k->right.reset(r);
+        if(r)
+            r->parent = k;
+        k->parent = nullptr;
+        _update(k);
+    }
+    /**
+     * @brief Helper function to detach the left subtree of a node.
+     * 
+     * @param _node Pointer to node.
+     * @return node* Pointer to the root of the detached subtree.
+     */
+    static node* _detach_left(node* const _node) noexcept {
+        auto child = _node->left.release();
+        if(child)
+            child->parent = nullptr;
+        return child;
+    }
+    /**
+     * @brief Helper function to detach the right subtree of a node.
+     * 
+     * @param _node Pointer to node.
+     * @return node* Pointer to the root of the detached subtree.
+     */
+    static node* _detach_right(node* const _node) noexcept {
+        auto child = _node->right.release();
+        if(child)
+            child->parent = nullptr;
+        return child;
+    }
+    /**
+     * @brief Helper function to join a detached node k and two detached subtrees, whose keys are less
+     * and greater than the key of k, into one balanced subtree, through the balancing policy.
+     * The head of the tree is used as scratch space, hence it must be empty.
+     * 
+     * @param l Pointer to the root of the left subtree.
+     * @param k Pointer to node.
+     * @param r Pointer to the root of the right subtree.
+     * @return node* Pointer to the root of the joined subtree.
+     */
+    node* _join(node* const l, node* const k, node* const r) noexcept {
+        Balance::join(*this, l, k, r);
+        return head.release();
+    }
+    /**
+     * @brief Helper function to split a detached subtree by a key, in O(height). Same requirements as _join().
+     * The path of the key is walked down, then back up through the parent links, joining every node of
+     * the path with its other subtree to the part of its side, so the stack does not grow with the height.
+     * 
+     * @param t Pointer to the root of the subtree.
+     * @param key Key.
+     * @return std::tuple<node*, node*, node*> Roots of the subtrees of the keys less and greater than
+     * key, and the detached node with the key, nullptr if it is not present.
+     */
+    std::tuple<node*, node*, node*> _split_key(node* const t, const KT& key) noexcept {
+        node* less = nullptr;
+        node* greater = nullptr;
+        node* match = nullptr;
+        // last node of the path, and the side of the key below it.
+        node* _node = t;
+        bool left = false;
+        while(_node){
+            if(f(key, _node->pair.first)){
+                left = true;
+                if(!_node->left)
+                    break;
+                _node = _node->left.get();
+            }
+            else if(f(_node->pair.first, key)){
+                left = false;
+                if(!_node->right)
+                    break;
+                _node = _node->right.get();
+            }
+            else{
+                match = _node;
+                _node = match->parent;
+                if(_node)
+                    left = _node->left.get() == match;
+                less = _detach_left(match);
+                greater = _detach_right(match);
+                match->parent = nullptr;
+                break;
+            }
+        }
+        while(_node){
+            // the child of _node on the path has already been split into less and greater.
+            const auto parent = _node->parent;
+            const auto from_left = parent && parent->left.get() == _node;
+            _node->parent = nullptr;
+            if(left){
+                _node->left.release();
+                greater = _join(greater, _node, _detach_right(_node));
+            }
+            else{
+                _node->right.release();
+                less = _join(_detach_left(_node), _node, less);
+            }
+            _node = parent;
+            left = from_left;
+        }
+        return {less, greater, match};
+    }
+    /**
+     * @brief Helper function to remove the last node of a detached subtree, walking down its right spine
+     * and back up through the parent links. Same requirements as _join().
+     * 
+     * @param t Pointer to the root of the subtree, not null.
+     * @param last Set to the detached last node.
+     * @return node* Pointer to the root of the remaining subtree.
+     */
+    node* _split_last(node* const t, node*& last) noexcept {
+        last = t;
+        while(last->right)
+            last = last->right.get();
+        auto _node = last->parent;
+        auto rest = _detach_left(last);
+        last->parent = nullptr;
+        while(_node){
+            const auto parent = _node->parent;
+            _node->parent = nullptr;
+            _node->right.release();
+            rest = _join(_detach_left(_node), _node, rest);
+            _node = parent;
+        }
+        return rest;
+    }
+    /**
+     * @brief Helper function to join two detached subtrees, the keys of the first being less than the
+     * ones of the second. Same requirements as _join().
+     * 
+     * @param l Pointer to the root of the left subtree.
+     * @param r Pointer to the root of the right subtree.
+     * @return node* Pointer to the root of the joined subtree.
+     */
+    node* _join(node* const l, node* const r) noexcept {
+        if(!l)
+            return r;
+        if(!r)
+            return l;
+        node* last;
+        const auto rest = _split_last(l, last);
+        return _join(rest, last, r);
+    }
+    /**
+     * @brief Helper function to bound the recursion of _union(), _intersect() and _difference(), which
+     * is as deep as the first subtree, i.e., this tree: without a balancing policy the tree may be
+     * degenerate, so it is balanced first, in O(n).
+     */
+    void _prepare_set_operation() noexcept {
+        if constexpr (std::is_same<Balance, no_balance>::value)
+            _rebuild();
+    }
+    /**
+     * @brief Helper function to compute the union of two detached subtrees, moving their nodes: the
+     * second one is split by the key of the root of the first one, and the unions of the two halves are
+     * joined back. Same requirements as _join().
+     * 
+     * @tparam D
+     * @param a Pointer to the root of the first subtree, whose pairs are kept.
+     * @param b Pointer to the root of the second subtree.
+     * @param duplicate Function called, in ascending order, with every detached node of b whose key is in a.
+     * @return node* Pointer to the root of the union.
+     */
+    template <typename D> node* _union(node* const a, node* const b, D& duplicate) noexcept {
+        if(!a)
+            return b;
+        if(!b)
+            return a;
+        const auto l = _detach_left(a);
+        const auto r = _detach_right(a);
+        const auto [less, greater, match] = _split_key(b, a->pair.first);
+        const auto left = _union(l, less, duplicate);
+        if(match)
+            duplicate(match);
+        return _join(left, a, _union(r, greater, duplicate));
+    }
+    /**
+     * @brief Helper function to compute the intersection of two detached subtrees, freeing the nodes
+     * which are not part of it. Same requirements as _join().
+     * 
+     * @param a Pointer to the root of the first subtree, whose pairs are kept.
+     * @param b Pointer to the root of the second subtree.
+     * @param count Incremented by the number of pairs of the intersection.
+     * @return node* Pointer to the root of the intersection.
+     */
+    node* _intersect(node* const a, node* const b, std::size_t& count) noexcept {
+        if(!a || !b){
+            _destroy_subtree(a);
+            _destroy_subtree(b);
+            return nullptr;
+        }
+        const auto l = _detach_left(a);
+        const auto r = _detach_right(a);
+        const auto [less, greater, match] = _split_key(b, a->pair.first);
+        const auto left = _intersect(l, less, count);
+        const auto right = _intersect(r, greater, count);
+        if(match){
+            _destroy_node(match);
+            ++count;
+            return _join(left, a, right);
+        }
+        _destroy_node(a);
+        return _join(left, right);
+    }
+    /**
+     * @brief Helper function to compute the difference of two detached subtrees, freeing the nodes
+     * which are not part of it. Same requirements as _join().
+     * 
+     * @param a Pointer to the root of the first subtree.
+     * @param b Pointer to the root of the second subtree, whose keys are removed from the first one.
+     * @param count Incremented by the number of pairs removed from the first subtree.
+     * @return node* Pointer to the root of the difference.
+     */
+    node* _difference(node* const a, node* const b, std::size_t& count) noexcept {
+        if(!a || !b){
+            _destroy_subtree(b);
+            return a;
+        }
+        const auto l = _detach_left(a);
+        const auto r = _detach_right(a);
+        const auto [less, greater, match] = _split_key(b, a->pair.first);
+        const auto left = _difference(l, less, count);
+        const auto right = _difference(r, greater, count);
+        if(match){
+            _destroy_node(match);
+            _destroy_node(a);
+            ++count;
+            return _join(left, right);
+        }
+        return _join(left, a, right);
+    }
+    /**
+     * @brief Helper function to count the nodes of one of two disjoint subtrees in O(min(n, m) + height),
+     * walking both in order at once until one of them ends, or in O(1) if the nodes store the size of
+     * their subtree.
+     * 
+     * @param a Pointer to the root of the subtree to be counted.
+     * @param b Pointer to the root of the other subtree.
+     * @param total Number of nodes of both subtrees.
+     * @return std::size_t Number of nodes of a.
+     */
+    static std::size_t _count_nodes(node* const a, node* const b, const std::size_t total) noexcept {
+        if constexpr (_has_subtree_size<node>::value){
+            (void)b;
+            (void)total;
+            return a ? a->subtree_size : 0;
+        }
+        else{
+            const auto first = [](node* _node){
+                while(_node && _node->left)
+                    _node = _node->left.get();
+                return _node;
+            };
+            std::size_t count = 0;
+            for(auto x = first(a), y = first(b); x && y; x = iterator::next(x), y = iterator::next(y))
+                ++count;
+            // the walk stopped at the end of the smaller subtree.
+            auto x = first(a);
+            for(std::size_t i = 0; x && i < count; ++i)
+                x = iterator::next(x);
+            return x ? total - count : count;
+        }
+    }
+    /**
+     * @brief Helper function returning a tree with the pairs of other and the allocator of this tree,
+     * whose nodes can therefore be moved into this tree: other itself if the allocators are equal,
+     * a copy otherwise. other is left empty. A moved-from tree gets a new header first.
+     * 
+     * @param other R-value reference to BST object.
+     * @return BST
+     */
+    BST _adopt(BST&& other){
+        _ensure_header();
+        if(alloc == other.alloc)
+            return std::move(other);
+        BST copy(other.cbegin(), other.cend(), f, Alloc(alloc));
+        other.clear();
+        return copy;
+    }
 
     public:
 
     /**
-     * @brief Emplace values inside BST. 
+     * @brief Emplace values inside BST. The pair is constructed directly in the node; if the
+     * arguments are a key and a value, only once the key is known not to be present.
+     * 
+     * @tparam Types 
+     * @param args arguments to be packed.
+     * @return IteratorBoolPair a pair of an iterator (pointing to node) and an bool. 
+     * The bool is true if a new node has been allocated, false otherwise
+     * (i.e., the key was already present in the tree). 
+     */
+    template <typename ... Types> // packing the types
+    IteratorBoolPair emplace(Types&& ... args) { //packing the arguments
+        return _emplace(std::nullopt, std::forward<Types>(args)...); //unpack
+    }
+    /**
+     * @brief Emplace values inside BST, as close as possible to the position just before a hint.
+     * If the key belongs right before (or right after) the hint, the node is linked there without
+     * descending from the root: inserting sorted keys with end() as hint takes amortized O(1).
+     * 
+     * @tparam Types
+     * @param hint Iterator to the position the key should be inserted before.
+     * @param args arguments forwarded to the constructor of the pair.
+     * @return iterator Iterator to the inserted pair, or to the one with the same key.
+     */
+    template <typename ... Types>
+    iterator emplace_hint(const iterator hint, Types&& ... args){
+        return _emplace(hint.get_node(), std::forward<Types>(args)...).first;
+    }
+    /**
+     * @brief Emplace a pair made of a key and a value constructed from the given arguments, if the key
+     * is not present. Nothing is constructed, nor are the arguments moved from, otherwise.
+     * 
+     * @tparam Types
+     * @param key L-value reference to the key.
+     * @param args arguments forwarded to the constructor of the value.
+     * @return IteratorBoolPair Same as emplace().
+     */
+    template <typename ... Types>
+    IteratorBoolPair try_emplace(const KT& key, Types&& ... args){
+        return _try_emplace(std::nullopt, key, std::forward<Types>(args)...);
+    }
+    /**
+     * @brief Emplace a pair made of a key and a value constructed from the given arguments, if the key
+     * is not present. Nothing is constructed, nor are the key and the arguments moved from, otherwise.
+     * 
+     * @tparam Types
+     * @param key R-value reference to the key.
+     * @param args arguments forwarded to the constructor of the value.
+     * @return IteratorBoolPair Same as emplace().
+     */
+    template <typename ... Types>
+    IteratorBoolPair try_emplace(KT&& key, Types&& ... args){
+        return _try_emplace(std::nullopt, std::move(key), std::forward<Types>(args)...);
+    }
+    /**
+     * @brief Insert a pair made of a key and a value if the key is not present, assign the value to
+     * the one mapped to the key otherwise.
+     * 
+     * @tparam M Type assignable to the value type.
+     * @param key L-value reference to the key.
+     * @param value Value to be inserted or assigned.
+     * @return IteratorBoolPair Same as emplace(): the bool is false if the value has been assigned.
+     */
+    template <typename M>
+    IteratorBoolPair insert_or_assign(const KT& key, M&& value){
+        auto result = _try_emplace(std::nullopt, key, std::forward<M>(value));
+        if(!result.second)
+            _assign(result.first.get_node(), std::forward<M>(value));
+        return result;
+    }
+    /**
+     * @brief Insert a pair made of a key and a value if the key is not present, assign the value to
+     * the one mapped to the key otherwise.
+     * 
+     * @tparam M Type assignable to the value type.
+     * @param key R-value reference to the key.
+     * @param value Value to be inserted or assigned.
+     * @return IteratorBoolPair Same as emplace(): the bool is false if the value has been assigned.
+     */
+    template <typename M>
+    IteratorBoolPair insert_or_assign(KT&& key, M&& value){
+        auto result = _try_emplace(std::nullopt, std::move(key), std::forward<M>(value));
+        if(!result.second)
+            _assign(result.first.get_node(), std::forward<M>(value));
+        return result;
+    }
+    /**
+     * @brief Assign a value to the one an iterator points to, and update the augmentation of the node
+     * and of its ancestors. This is the way to change a value when it is cached by the augmentation,
+     * in O(height), as the iterators give read only access to it.
+     * 
+     * @tparam M Type assignable to the value type.
+     * @param position Valid, dereferenceable, iterator to the node.
+     * @param value Value to be assigned.
+     */
+    template <typename M>
+    void assign(const iterator position, M&& value){ _assign(position.get_node(), std::forward<M>(value)); }
+    /**
+     * @brief Call a function on the value mapped to a key, if present, and update the augmentation of
+     * the node and of its ancestors, e.g. `tree.update(key, [](int& v){ v += 1; })`.
+     * 
+     * @tparam Function Callable with a VT&.
+     * @param key Key whose value is updated.
+     * @param fn Function modifying the value.
+     * @return bool True if the key is present, false otherwise (fn is not called).
+     */
+    template <typename Function>
+    bool update(const KT& key, Function&& fn){
+        auto _node = _find(key);
+        if(!_node)
+            return false;
+        try{
+            std::forward<Function>(fn)(_node->pair.second);
+        }
+        catch(...){
+            _update_path(_node);
+            throw;
+        }
+        _update_path(_node);
+        return true;
+    }
+
+    /**
+     * @brief Clears the tree.
+     * 
+     */
+    void clear() noexcept{
+        if(!_release_all_nodes())
+            _destroy_subtree(head.get());
+        head.release();
+        _set_extremes(nullptr, nullptr);
+        _size = 0;
+    }
+
+    /**
+     * @brief Finds a given key. If the key is present, returns an iterator to the proper node,
+     *  end() otherwise.
+     * 
+     * @param key
+     * @return iterator
+     */
+    auto find(const KT& key) noexcept {return iterator{_find(key), _last()}; }
+    //iterator find(KT&& x) noexcept{ return iterator{_find(std::move(x)), _last()}; }
+
+    // dont need to implement both versions for r value and l value since an r value is coherent with a const
+    // reference (a const reference cannot be in the left side of an assignment)
+    /**
+     * @brief Const version of find().
+     * 
+     * @param key
+     * @return const_iterator 
+     */
+    auto find(const KT& key) const noexcept{ return const_iterator{_find(key), _last()}; } 
+    //const_iterator find(KT&& x) const noexcept{return const_iterator{_find(std::move(x)), _last()}; }
+
+    // Heterogeneous lookup: when the comparison operator is transparent (it defines is_transparent,
+    // e.g. std::less<>), keys can be looked up through any type comparable with KT (e.g. a
+    // std::string_view or a const char* for std::string keys) without constructing a KT.
+    /**
+     * @brief Heterogeneous version of find(). Enabled only if F is transparent.
+     * 
+     * @tparam K Type comparable with the key type.
+     * @param key
+     * @return iterator
+     */
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    auto find(const K& key) noexcept {return iterator{_find(key), _last()}; }
+    /**
+     * @brief Heterogeneous version of find() const. Enabled only if F is transparent.
+     * 
+     * @tparam K Type comparable with the key type.
+     * @param key
+     * @return const_iterator
+     */
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    auto find(const K& key) const noexcept {return const_iterator{_find(key), _last()}; }
+
+    /**
+     * @brief Finds a batch of keys, writing for every key an iterator to the proper node, or end() if
+     * the key is not present. Up to 16 descents are interleaved, prefetching the next node of each
+     * of them, so that the cache misses of different keys overlap: on trees larger than the cache
+     * this is faster than calling find() in a loop.
+     * 
+     * @tparam It Forward iterator to keys (to any type comparable with the key type if F is transparent).
+     * @tparam Out Output iterator accepting iterators.
+     * @param first Iterator to the first key.
+     * @param last Iterator to one-past the last key.
+     * @param out Iterator to the first output.
+     * @return Out Iterator to one-past the last output.
+     */
+    template <typename It, typename Out>
+    Out find_batch(It first, It last, Out out) noexcept { return _find_batch<iterator>(first, last, out); }
+    /**
+     * @brief Const version of find_batch(), writing constant iterators.
+     * 
+     * @tparam It Forward iterator to keys.
+     * @tparam Out Output iterator accepting constant iterators.
+     * @param first Iterator to the first key.
+     * @param last Iterator to one-past the last key.
+     * @param out Iterator to the first output.
+     * @return Out Iterator to one-past the last output.
+     */
+    template <typename It, typename Out>
+    Out find_batch(It first, It last, Out out) const noexcept { return _find_batch<const_iterator>(first, last, out); }
+
+    /**
+     * @brief Returns an iterator to the first node whose key is not less than the given key, end() if
+     * there is none.
+     * 
+     * @param key
+     * @return iterator
+     */
+    auto lower_bound(const KT& key) noexcept { return iterator{_lower_bound(key), _last()}; }
+    /**
+     * @brief Const version of lower_bound().
+     * 
+     * @param key
+     * @return const_iterator
+     */
+    auto lower_bound(const KT& key) const noexcept { return const_iterator{_lower_bound(key), _last()}; }
+    /**
+     * @brief Heterogeneous version of lower_bound(). Enabled only if F is transparent.
+     * 
+     * @tparam K Type comparable with the key type.
+     * @param key
+     * @return iterator
+     */
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    auto lower_bound(const K& key) noexcept { return iterator{_lower_bound(key), _last()}; }
+    /**
+     * @brief Heterogeneous version of lower_bound() const. Enabled only if F is transparent.
+     * 
+     * @tparam K Type comparable with the key type.
+     * @param key
+     * @return const_iterator
+     */
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    auto lower_bound(const K& key) const noexcept { return const_iterator{_lower_bound(key), _last()}; }
+
+    /**
+     * @brief Returns an iterator to the first node whose key is greater than the given key, end() if
+     * there is none.
+     * 
+     * @param key
+     * @return iterator
+     */
+    auto upper_bound(const KT& key) noexcept { return iterator{_upper_bound(key), _last()}; }
+    /**
+     * @brief Const version of upper_bound().
+     * 
+     * @param key
+     * @return const_iterator
+     */
+    auto upper_bound(const KT& key) const noexcept { return const_iterator{_upper_bound(key), _last()}; }
+    /**
+     * @brief Heterogeneous version of upper_bound(). Enabled only if F is transparent.
+     * 
+     * @tparam K Type comparable with the key type.
+     * @param key
+     * @return iterator
+     */
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    auto upper_bound(const K& key) noexcept { return iterator{_upper_bound(key), _last()}; }
+    /**
+     * @brief Heterogeneous version of upper_bound() const. Enabled only if F is transparent.
+     * 
+     * @tparam K Type comparable with the key type.
+     * @param key
+     * @return const_iterator
+     */
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    auto upper_bound(const K& key) const noexcept { return const_iterator{_upper_bound(key), _last()}; }
+
+    /**
+     * @brief Returns the pair of iterators [lower_bound(key), upper_bound(key)), i.e., the range of the
+     * nodes with the given key.
+     * 
+     * @param key
+     * @return std::pair<iterator, iterator>
+     */
+    auto equal_range(const KT& key) noexcept {
+        auto bounds = _equal_range(key);
+        return std::make_pair(iterator{bounds.first, _last()}, iterator{bounds.second, _last()});
+    }
+    /**
+     * @brief Const version of equal_range().
+     * 
+     * @param key
+     * @return std::pair<const_iterator, const_iterator>
+     */
+    auto equal_range(const KT& key) const noexcept {
+        auto bounds = _equal_range(key);
+        return std::make_pair(const_iterator{bounds.first, _last()}, const_iterator{bounds.second, _last()});
+    }
+    /**
+     * @brief Heterogeneous version of equal_range(). Enabled only if F is transparent.
+     * 
+     * @tparam K Type comparable with the key type.
+     * @param key
+     * @return std::pair<iterator, iterator>
+     */
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    auto equal_range(const K& key) noexcept {
+        auto bounds = _equal_range(key);
+        return std::make_pair(iterator{bounds.first, _last()}, iterator{bounds.second, _last()});
+    }
+    /**
+     * @brief Heterogeneous version of equal_range() const. Enabled only if F is transparent.
+     * 
+     * @tparam K Type comparable with the key type.
+     * @param key
+     * @return std::pair<const_iterator, const_iterator>
+     */
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    auto equal_range(const K& key) const noexcept {
+        auto bounds = _equal_range(key);
+        return std::make_pair(const_iterator{bounds.first, _last()}, const_iterator{bounds.second, _last()});
+    }
+
+    /**
+     * @brief Returns a lazy view over the nodes with keys in [low, high), which can be used in a
+     * range-for loop. Nothing is copied: the view holds two iterators. The view is empty if high
+     * is not greater than low.
+     * 
+     * @param low Lower bound, included.
+     * @param high Upper bound, excluded.
+     * @return _iterator_range<iterator>
+     */
+    auto range(const KT& low, const KT& high) noexcept {
+        auto bounds = _range(low, high);
+        return _iterator_range<iterator>{iterator{bounds.first, _last()}, iterator{bounds.second, _last()}};
+    }
+    /**
+     * @brief Const version of range().
+     * 
+     * @param low Lower bound, included.
+     * @param high Upper bound, excluded.
+     * @return _iterator_range<const_iterator>
+     */
+    auto range(const KT& low, const KT& high) const noexcept {
+        auto bounds = _range(low, high);
+        return _iterator_range<const_iterator>{const_iterator{bounds.first, _last()}, const_iterator{bounds.second, _last()}};
+    }
+    /**
+     * @brief Heterogeneous version of range(). Enabled only if F is transparent.
      * 
-     * @tparam Types 
-     * @param args arguments to be packed.
-     * @return IteratorBoolPair a pair of an iterator (pointing to node) and an bool. 
-     * The bool is true if a new node has been allocated, false otherwise
-     * (i.e., the key was already present in the tree). 
+     * @tparam K1 Type comparable with the key type.
+     * @tparam K2 Type comparable with the key type.
+     * @param low Lower bound, included.
+     * @param high Upper bound, excluded.
+     * @return _iterator_range<iterator>
      */
-    template <typename ... Types> // packing the types
-    IteratorBoolPair emplace(Types&& ... args) { //packing the arguments
-        return insert(PairType{std::forward<Types>(args)...}); //unpack
+    template <typename K1, typename K2, typename G = F, typename = typename G::is_transparent>
+    auto range(const K1& low, const K2& high) noexcept {
+        auto bounds = _range(low, high);
+        return _iterator_range<iterator>{iterator{bounds.first, _last()}, iterator{bounds.second, _last()}};
     }
-
     /**
-     * @brief Clears the tree.
+     * @brief Heterogeneous version of range() const. Enabled only if F is transparent.
      * 
+     * @tparam K1 Type comparable with the key type.
+     * @tparam K2 Type comparable with the key type.
+     * @param low Lower bound, included.
+     * @param high Upper bound, excluded.
+     * @return _iterator_range<const_iterator>
      */
-    void clear() noexcept{
-        _size = 0;
-        head.reset();
+    template <typename K1, typename K2, typename G = F, typename = typename G::is_transparent>
+    auto range(const K1& low, const K2& high) const noexcept {
+        auto bounds = _range(low, high);
+        return _iterator_range<const_iterator>{const_iterator{bounds.first, _last()}, const_iterator{bounds.second, _last()}};
     }
 
+    // Order statistics: available only with the order_statistics augmentation, in O(height).
     /**
-     * @brief Finds a given key. If the key is present, returns an iterator to the proper node,
-     *  end() otherwise.
+     * @brief Returns the rank of a key, i.e., the number of keys in the BST which are less than key.
      * 
      * @param key
+     * @return std::size_t
+     */
+    std::size_t rank(const KT& key) const noexcept { return _rank(key); }
+    /**
+     * @brief Heterogeneous version of rank(). Enabled only if F is transparent.
+     * 
+     * @tparam K Type comparable with the key type.
+     * @param key
+     * @return std::size_t
+     */
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    std::size_t rank(const K& key) const noexcept { return _rank(key); }
+    /**
+     * @brief Returns an iterator to the k-th node in order (starting from 0), end() if k is not less
+     * than the size of the BST.
+     * 
+     * @param k Position of the node.
      * @return iterator
      */
-    auto find(const KT& key) noexcept {return iterator{_find(key)}; }
-    //iterator find(KT&& x) noexcept{ return iterator{_find(std::move(x))}; }
+    auto select(const std::size_t k) noexcept {
+        static_assert(_has_subtree_size<node>::value, "select() requires the order_statistics augmentation.");
+        return iterator{iterator::select(head.get(), k), _last()};
+    }
+    /**
+     * @brief Const version of select().
+     * 
+     * @param k Position of the node.
+     * @return const_iterator
+     */
+    auto select(const std::size_t k) const noexcept {
+        static_assert(_has_subtree_size<node>::value, "select() requires the order_statistics augmentation.");
+        return const_iterator{iterator::select(head.get(), k), _last()};
+    }
+    /**
+     * @brief Returns the number of keys in [low, high), 0 if high is not greater than low.
+     * 
+     * @param low Lower bound, included.
+     * @param high Upper bound, excluded.
+     * @return std::size_t
+     */
+    std::size_t count_in_range(const KT& low, const KT& high) const noexcept { return _count_in_range(low, high); }
+    /**
+     * @brief Heterogeneous version of count_in_range(). Enabled only if F is transparent.
+     * 
+     * @tparam K1 Type comparable with the key type.
+     * @tparam K2 Type comparable with the key type.
+     * @param low Lower bound, included.
+     * @param high Upper bound, excluded.
+     * @return std::size_t
+     */
+    template <typename K1, typename K2, typename G = F, typename = typename G::is_transparent>
+    std::size_t count_in_range(const K1& low, const K2& high) const noexcept { return _count_in_range(low, high); }
 
-    // dont need to implement both versions for r value and l value since an r value is coherent with a const
-    // reference (a const reference cannot be in the left side of an assignment)
+    // Aggregates: available only with the monoid_augment augmentation.
     /**
-     * @brief Const version of find().
+     * @brief Returns the combination, in order, of all the values of the BST, in O(1).
+     * 
+     * @return Aggregate of the values.
+     */
+    auto aggregate() const { return Augment::summary(head.get()); }
+    /**
+     * @brief Returns the combination, in order, of the values of the keys in [low, high), in O(height).
+     * Returns the identity of the monoid if high is not greater than low.
+     * 
+     * @param low Lower bound, included.
+     * @param high Upper bound, excluded.
+     * @return Aggregate of the values.
+     */
+    auto aggregate(const KT& low, const KT& high) const { return _aggregate(low, high); }
+    /**
+     * @brief Heterogeneous version of aggregate(). Enabled only if F is transparent.
+     * 
+     * @tparam K1 Type comparable with the key type.
+     * @tparam K2 Type comparable with the key type.
+     * @param low Lower bound, included.
+     * @param high Upper bound, excluded.
+     * @return Aggregate of the values.
+     */
+    template <typename K1, typename K2, typename G = F, typename = typename G::is_transparent>
+    auto aggregate(const K1& low, const K2& high) const { return _aggregate(low, high); }
+
+    /**
+     * @brief Returns the number of nodes with the given key, i.e., 1 if the key is present and 0 otherwise.
      * 
      * @param key
-     * @return const_iterator 
+     * @return std::size_t
+     */
+    std::size_t count(const KT& key) const noexcept { return _find(key) ? 1 : 0; }
+    /**
+     * @brief Heterogeneous version of count(). Enabled only if F is transparent.
+     * 
+     * @tparam K Type comparable with the key type.
+     * @param key
+     * @return std::size_t
+     */
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    std::size_t count(const K& key) const noexcept { return _find(key) ? 1 : 0; }
+    /**
+     * @brief Returns true if the key is present in the BST, false otherwise.
+     * 
+     * @param key
+     * @return bool
+     */
+    bool contains(const KT& key) const noexcept { return _find(key) != nullptr; }
+    /**
+     * @brief Heterogeneous version of contains(). Enabled only if F is transparent.
+     * 
+     * @tparam K Type comparable with the key type.
+     * @param key
+     * @return bool
      */
-    auto find(const KT& key) const noexcept{ return const_iterator{_find(key)}; } 
-    //const_iterator find(KT&& x) const noexcept{return const_iterator{_find(std::move(x))}; }
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    bool contains(const K& key) const noexcept { return _find(key) != nullptr; }
 
     /**
      * @brief Subscripting operator. Returns a reference to the value type of the node if the
@@ -384,6 +2240,17 @@ class BST{
      * @return VT& reference to value type.
      */
     VT& operator[](KT&& key) { return _sub(std::move(key)); }
+    /**
+     * @brief Heterogeneous subscripting operator. Enabled only if F is transparent and KT can be
+     * constructed from K. A KT is constructed only if the key is not present and must be inserted.
+     * 
+     * @tparam K Type comparable with the key type.
+     * @param key Key to be subscripted.
+     * @return VT& reference to value type.
+     */
+    template <typename K, typename G = F, typename = typename G::is_transparent,
+              typename = std::enable_if_t<std::is_constructible<KT, const K&>::value>>
+    VT& operator[](const K& key) { return _sub(key); }
     
     /**
      * @brief Returns iterator to the beginning of the BST. 
@@ -391,7 +2258,7 @@ class BST{
      * @return iterator
      */
     auto begin() noexcept{ 
-        return iterator{_leftmost_node()};
+        return iterator{_first(), _last()};
     }
     /**
      * @brief Returns constant iterator to the beginning of the BST.  
@@ -399,7 +2266,7 @@ class BST{
      * @return const_iterator
      */
     auto begin() const noexcept { 
-        return const_iterator{_leftmost_node()};
+        return const_iterator{_first(), _last()};
     }
     /**
      * @brief Returns constant iterator to the beginning of the BST.  
@@ -407,7 +2274,7 @@ class BST{
      * @return const_iterator
      */
     auto cbegin() const noexcept{
-        return const_iterator{_leftmost_node()};
+        return const_iterator{_first(), _last()};
     }
     /**
      * @brief Returns iterator to end of BST. 
@@ -415,7 +2282,7 @@ class BST{
      * @return iterator
      */
     auto end() noexcept { 
-        return iterator{nullptr};
+        return iterator{nullptr, _last()};
     }
     /**
      * @brief Returns constant iterator to end of BST. 
@@ -423,7 +2290,7 @@ class BST{
      * @return const_iterator
      */
     auto end() const noexcept{
-        return const_iterator{nullptr};
+        return const_iterator{nullptr, _last()};
     }
     /**
      * @brief Returns constant iterator to end of BST. 
@@ -431,25 +2298,138 @@ class BST{
      * @return const_iterator
      */
     auto cend() const noexcept{
-        return const_iterator{nullptr};
+        return const_iterator{nullptr, _last()};
+    }
+    /**
+     * @brief Returns reverse iterator to the last element of the BST. 
+     * 
+     * @return std::reverse_iterator<iterator>
+     */
+    auto rbegin() noexcept { 
+        return std::reverse_iterator<iterator>{end()};
+    }
+    /**
+     * @brief Returns constant reverse iterator to the last element of the BST. 
+     * 
+     * @return std::reverse_iterator<const_iterator>
+     */
+    auto rbegin() const noexcept { 
+        return std::reverse_iterator<const_iterator>{end()};
+    }
+    /**
+     * @brief Returns constant reverse iterator to the last element of the BST. 
+     * 
+     * @return std::reverse_iterator<const_iterator>
+     */
+    auto crbegin() const noexcept { 
+        return std::reverse_iterator<const_iterator>{cend()};
+    }
+    /**
+     * @brief Returns reverse iterator to one-before the first element of the BST. 
+     * 
+     * @return std::reverse_iterator<iterator>
+     */
+    auto rend() noexcept { 
+        return std::reverse_iterator<iterator>{begin()};
+    }
+    /**
+     * @brief Returns constant reverse iterator to one-before the first element of the BST. 
+     * 
+     * @return std::reverse_iterator<const_iterator>
+     */
+    auto rend() const noexcept { 
+        return std::reverse_iterator<const_iterator>{begin()};
+    }
+    /**
+     * @brief Returns constant reverse iterator to one-before the first element of the BST. 
+     * 
+     * @return std::reverse_iterator<const_iterator>
+     */
+    auto crend() const noexcept { 
+        return std::reverse_iterator<const_iterator>{cbegin()};
     }
 
+    /**
+     * @brief Returns the diagnostics policy of the BST, holding the events recorded so far.
+     * 
+     * @return Trace& Reference to the diagnostics policy.
+     */
+    Trace& trace() noexcept { return _trace; }
+    /**
+     * @brief Const version of trace().
+     * 
+     * @return const Trace& Const reference to the diagnostics policy.
+     */
+    const Trace& trace() const noexcept { return _trace; }
+
     /**
      * @brief Construct a new BST object. Default constructor.
      * 
      */
-    BST() noexcept = default;
+    BST() = default;
     /**
      * @brief Construct a new BST object.
      * 
      * @param f Comparison operator.
+     * @param alloc Allocator. 
      */
-    BST(F f) noexcept: f{std::move(f)}{}; 
+    BST(F f, const Alloc& alloc = Alloc{}): f{std::move(f)}, alloc{alloc}{}; 
+    /**
+     * @brief Construct a new BST object.
+     * 
+     * @param alloc Allocator. 
+     */
+    explicit BST(const Alloc& alloc): alloc{alloc}{}; 
+    /**
+     * @brief Construct a new BST object from a range of pairs sorted by key, in O(n).
+     * Pairs with duplicated keys are skipped, keeping the first one. If the range is not sorted, the
+     * pairs following the first one out of order are inserted one by one.
+     * 
+     * @tparam It Input iterator to pairs.
+     * @param sorted_first Iterator to the first pair.
+     * @param sorted_last Iterator to one-past the last pair.
+     * @param f Comparison operator.
+     * @param alloc Allocator. 
+     */
+    template <typename It, typename = typename std::iterator_traits<It>::iterator_category>
+    BST(It sorted_first, It sorted_last, F f = F{}, const Alloc& alloc = Alloc{}): f{std::move(f)}, alloc{alloc}{
+        try{
+            _build_from_sorted(sorted_first, sorted_last);
+        }
+        catch(...){
+            clear();
+            throw;
+        }
+    }
+    /**
+     * @brief Construct a new BST object from a random-access range of pairs sorted by key, in O(n),
+     * creating and linking the nodes on several threads. Same semantics as the sequential constructor,
+     * to which it falls back if the range is not strictly increasing.
+     * 
+     * @tparam It Random access iterator to pairs.
+     * @param policy Number of threads.
+     * @param sorted_first Iterator to the first pair.
+     * @param sorted_last Iterator to one-past the last pair.
+     * @param f Comparison operator.
+     * @param alloc Allocator. 
+     */
+    template <typename It, typename = std::enable_if_t<std::is_base_of<std::random_access_iterator_tag,
+                                          typename std::iterator_traits<It>::iterator_category>::value>>
+    BST(const parallel_policy policy, It sorted_first, It sorted_last, F f = F{}, const Alloc& alloc = Alloc{}):
+        f{std::move(f)}, alloc{alloc}{
+        try{
+            _build_from_sorted(sorted_first, sorted_last, policy.threads);
+        }
+        catch(...){
+            clear();
+            throw;
+        }
+    }
     /**
      * @brief Destroy the BST object.
      * 
      */
-    ~BST() noexcept= default; 
+    ~BST() noexcept{ clear(); } 
 
     // copy semantics 
 
@@ -458,10 +2438,41 @@ class BST{
      * 
      * @param bst2 Reference to BST object.
      */
-    BST(const BST &bst2): f{bst2.f}, _size{bst2._size}  {
+    BST(const BST &bst2): f{bst2.f}, alloc{node_traits::select_on_container_copy_construction(bst2.alloc)}  {
         if(bst2.head.get()){
-            head.reset(new node{bst2.head, nullptr});
+            try{
+                head.reset(_create_node(*bst2.head, nullptr));
+                _copy_children(bst2.head.get(), head.get());
+            }
+            catch(...){
+                clear();
+                throw;
+            }
         }      
+        _size = bst2._size;
+        _reset_extremes();
+    }
+    /**
+     * @brief Copy constructor of BST copying the nodes on several threads: the top levels of the tree
+     * are copied first, then the subtrees below them by independent tasks. The nodes are allocated by
+     * the calling thread only, unless the allocator is std::allocator (see _concurrent_allocator).
+     * 
+     * @param bst2 Reference to BST object.
+     * @param policy Number of threads.
+     */
+    BST(const BST &bst2, const parallel_policy policy): f{bst2.f}, alloc{node_traits::select_on_container_copy_construction(bst2.alloc)}  {
+        if(bst2.head.get()){
+            try{
+                head.reset(_create_node(*bst2.head, nullptr));
+                _copy_children(bst2.head.get(), head.get(), bst2._size < _parallel_grain ? 1 : policy.threads);
+            }
+            catch(...){
+                clear();
+                throw;
+            }
+        }
+        _size = bst2._size;
+        _reset_extremes();
     }
     /**
      * @brief Copy assignment of BST.
@@ -476,19 +2487,49 @@ class BST{
     }
 
 
-    // Move semantics. No raw ptrs so default move is fine.
+    // Move semantics. The nodes are freed through the allocator, so the links cannot simply be moved
+    // around by the default operations.
     /**
-     * @brief Default move constructor of BST.
+     * @brief Move constructor of BST. Takes the nodes, their header and the allocator of bst2, which is
+     * left empty. The iterators of bst2, end() included, stay valid and refer to this tree.
      * 
+     * @param bst2 R-value reference to BST object.
      */
-    BST(BST &&) noexcept = default;
+    BST(BST &&bst2) noexcept: f{std::move(bst2.f)}, alloc{bst2.alloc}, _size{bst2._size}, head{bst2.head.release()},
+                                _ends{std::move(bst2._ends)} {
+        bst2._size = 0;
+    }
 
     /**
-     * @brief Default move assignment of BST.
+     * @brief Move assignment of BST. The nodes of bst2 are taken if the allocator propagates or the two
+     * allocators are equal, otherwise the pairs are copied one by one into nodes of this allocator.
+     * The iterators of this tree are invalidated. Those of bst2 refer to this tree if its nodes are
+     * taken, and are invalidated otherwise.
      * 
+     * @param bst2 R-value reference to BST object.
      * @return Reference to BST object.
      */
-    BST& operator=(BST &&) noexcept = default;
+    BST& operator=(BST &&bst2) noexcept(node_traits::propagate_on_container_move_assignment::value ||
+                                        node_traits::is_always_equal::value) {
+        if(this == &bst2)
+            return *this;
+        clear();
+        f = std::move(bst2.f);
+        if constexpr (node_traits::propagate_on_container_move_assignment::value){
+            alloc = bst2.alloc;
+        }
+        else if(!(alloc == bst2.alloc)){
+            for(const auto& x: bst2)
+                insert(x);
+            bst2.clear();
+            return *this;
+        }
+        head.reset(bst2.head.release());
+        _size = bst2._size;
+        _ends = std::move(bst2._ends);
+        bst2._size = 0;
+        return *this;
+    }
 
     /**
      * @brief Insert a <key,value> pair in the BST.
@@ -510,12 +2551,244 @@ class BST{
      * type std::pair<iterator,bool>
      */
     IteratorBoolPair insert(PairType&& pair) { return _insert(std::move(pair));}
+    /**
+     * @brief Insert a pair in the BST, as close as possible to the position just before a hint
+     * (see emplace_hint()).
+     * 
+     * @param hint Iterator to the position the key should be inserted before.
+     * @param pair L-value reference to the pair to be inserted.
+     * @return iterator Iterator to the inserted pair, or to the one with the same key.
+     */
+    iterator insert(const iterator hint, const PairType& pair){
+        return _insert_key_hint(hint.get_node(), pair.first, [this, &pair]{ return _create_pair_node(pair); }).first;
+    }
+    /**
+     * @brief Insert a pair in the BST, as close as possible to the position just before a hint
+     * (see emplace_hint()).
+     * 
+     * @param hint Iterator to the position the key should be inserted before.
+     * @param pair R-value reference to the pair to be inserted.
+     * @return iterator Iterator to the inserted pair, or to the one with the same key.
+     */
+    iterator insert(const iterator hint, PairType&& pair){
+        return _insert_key_hint(hint.get_node(), pair.first, [this, &pair]{ return _create_pair_node(std::move(pair)); }).first;
+    }
+    /**
+     * @brief Inserts a batch of pairs, like calling insert() on each of them in order. The pairs are
+     * processed in groups of 16: the descents of a group are first interleaved with prefetching, as
+     * in find_batch(), then the pairs whose key is missing are linked. Without a balancing policy the
+     * shape of the tree above the nodes reached by the descents does not change, so each insertion
+     * resumes from there; otherwise it starts again from the root, along a path which is now cached.
+     * 
+     * @tparam It Forward iterator to pairs (a std::move_iterator moves the pairs into the nodes).
+     * @param first Iterator to the first pair.
+     * @param last Iterator to one-past the last pair.
+     * @return std::size_t Number of new nodes.
+     */
+    template <typename It> std::size_t insert_batch(It first, const It last){
+        node* nodes[_batch_width];
+        bool found[_batch_width];
+        std::size_t inserted = 0;
+        while(first != last){
+            auto group = first;
+            std::size_t count = 0;
+            for(; first != last && count < _batch_width; ++first)
+                ++count;
+            _descend_group(group, count, [](const auto& pair) -> const auto& { return pair.first; }, nodes, found);
+            for(std::size_t i = 0; i < count; ++i, ++group){
+                if(found[i])
+                    continue;
+                // the descents are not reported to the diagnostics policy.
+                if constexpr (std::is_same<Balance, no_balance>::value){
+                    inserted += (nodes[i] ? _insert_below(nodes[i], *group) : _insert(*group, _operation_counter<false>{})).second;
+                }
+                else{
+                    inserted += _insert(*group, _operation_counter<false>{}).second;
+                }
+            }
+        }
+        return inserted;
+    }
+    /**
+     * @brief Inserts the pairs of several ranges, each one sorted by key (e.g. input iterators reading
+     * sorted files), without materializing them: the ranges are merged k-way, one pair at a time, into
+     * a new tree built in O(m) like by the sorted range constructor, whose nodes are then moved into
+     * this tree by union_with(). Besides the nodes, the extra memory is O(k). Keys already present keep
+     * their pair, and among the ranges the first one holding a key wins, like inserting the ranges in
+     * order would do.
+     * 
+     * @tparam It Input iterator to pairs.
+     * @param ranges Pairs of iterators to the first and past the last pair of each range.
+     */
+    template <typename It> void ingest_sorted(std::vector<std::pair<It, It>> ranges){
+        _kway_merge<It, F> merge{std::move(ranges), f};
+        union_with(BST(merge.begin(), merge.end(), f, Alloc(alloc)));
+    }
+    /**
+     * @brief Inserts the pairs of an unsorted range (e.g. an input iterator reading a file) in chunks:
+     * up to chunk pairs are read into a buffer, sorted, built into a tree in O(chunk) and moved into
+     * this tree by union_with(), so the extra memory is bounded by the buffer whatever the length of the
+     * range. Duplicated keys are resolved like by insert(): the first pair with a key is kept.
+     * 
+     * @tparam It Input iterator to pairs.
+     * @param first Iterator to the first pair.
+     * @param last Iterator to one-past the last pair.
+     * @param chunk Maximum number of pairs held by the buffer. Default: 65536.
+     */
+    template <typename It> void ingest(It first, const It last, const std::size_t chunk = std::size_t{1} << 16){
+        const auto limit = std::max<std::size_t>(chunk, 1);
+        std::vector<std::pair<KT, VT>> buffer;
+        const auto by_key = [this](const std::pair<KT, VT>& a, const std::pair<KT, VT>& b){ return f(a.first, b.first); };
+        while(first != last){
+            buffer.reserve(limit);
+            for(; first != last && buffer.size() < limit; ++first)
+                buffer.push_back(*first);
+            // stable, so that the first of the pairs with the same key is the one kept.
+            std::stable_sort(buffer.begin(), buffer.end(), by_key);
+            union_with(BST(std::make_move_iterator(buffer.begin()), std::make_move_iterator(buffer.end()), f, Alloc(alloc)));
+            buffer.clear();
+        }
+    }
     /**
      * @brief Erase a key from the BST.
      * 
      * @param key L-value reference to key to be erased.
      */
     void erase(const KT&key) noexcept { return _erase(key); }
+    /**
+     * @brief Heterogeneous version of erase(). Enabled only if F is transparent.
+     * 
+     * @tparam K Type comparable with the key type.
+     * @param key Key to be erased.
+     */
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    void erase(const K& key) noexcept { return _erase(key); }
+
+    /**
+     * @brief Node handle, like std::map::node_type: owns a node extracted from a tree, together with
+     * a copy of the allocator of the tree. The node can be inserted into any tree with an equal
+     * allocator without any allocation or copy, and its key can be changed meanwhile. If the handle
+     * still owns its node when destroyed, the node is freed.
+     */
+    class node_type{
+        friend class BST;
+
+        node* _node{nullptr};
+        std::optional<node_allocator> alloc;
+
+        node_type(node* const _node, const node_allocator& alloc) noexcept: _node{_node}, alloc{alloc} {}
+
+        /**
+         * @brief Give up the ownership of the node, leaving the handle empty.
+         */
+        node* release() noexcept {
+            auto released = _node;
+            _node = nullptr;
+            alloc.reset();
+            return released;
+        }
+        /**
+         * @brief Free the node, if any, leaving the handle empty.
+         */
+        void reset() noexcept {
+            if(_node){
+                node_traits::destroy(*alloc, _node);
+                node_traits::deallocate(*alloc, _node, 1);
+            }
+            release();
+        }
+
+        public:
+        using key_type = KT;
+        using mapped_type = VT;
+        using allocator_type = Alloc;
+
+        /**
+         * @brief Construct an empty handle.
+         */
+        node_type() noexcept = default;
+        node_type(node_type&& other) noexcept: alloc{other.alloc} { _node = other.release(); }
+        node_type& operator=(node_type&& other) noexcept {
+            if(this != &other){
+                reset();
+                alloc = other.alloc;
+                _node = other.release();
+            }
+            return *this;
+        }
+        ~node_type() noexcept { reset(); }
+
+        bool empty() const noexcept { return !_node; }
+        explicit operator bool() const noexcept { return _node != nullptr; }
+        /**
+         * @brief Returns a reference to the key of the node, which may be modified before the node is
+         * inserted again. The handle must not be empty.
+         *
+         * @return key_type&
+         */
+        key_type& key() const noexcept { return const_cast<key_type&>(_node->pair.first); }
+        /**
+         * @brief Returns a reference to the value of the node. The handle must not be empty.
+         *
+         * @return mapped_type&
+         */
+        mapped_type& mapped() const noexcept { return _node->pair.second; }
+        allocator_type get_allocator() const { return allocator_type(*alloc); }
+    };
+
+    /**
+     * @brief Result of the insertion of a node handle: the position of the key, whether the node has
+     * been inserted and, if not, the handle still owning it.
+     */
+    struct insert_return_type{
+        iterator position;
+        bool inserted;
+        node_type node;
+    };
+
+    /**
+     * @brief Unlink the node with the given key from the tree, without freeing it, keeping the tree
+     * balanced. Returns a handle owning the node, empty if the key is not present.
+     * 
+     * @param key Key to be extracted.
+     * @return node_type
+     */
+    node_type extract(const KT& key){
+        auto _node = _find(key, trace_operation::erase);
+        return _node ? node_type{_unlink(_node), alloc} : node_type{};
+    }
+    /**
+     * @brief Unlink the node an iterator points to from the tree, without freeing it.
+     * 
+     * @param position Valid, dereferenceable, iterator to the node.
+     * @return node_type
+     */
+    node_type extract(const iterator position) noexcept {
+        return node_type{_unlink(position.get_node()), alloc};
+    }
+    /**
+     * @brief Insert the node owned by a handle, if its key is not present, without any allocation.
+     * The allocator of the handle must be equal to the one of the tree: otherwise, its pair is moved
+     * into a new node, and the node of the handle is freed.
+     * 
+     * @param handle R-value reference to the node handle.
+     * @return insert_return_type Position of the key, true and an empty handle if the node has been
+     * inserted, false and the handle otherwise.
+     */
+    insert_return_type insert(node_type&& handle){
+        if(handle.empty())
+            return insert_return_type{end(), false, node_type{}};
+        _ensure_header();
+        IteratorBoolPair result;
+        if(*handle.alloc == alloc)
+            result = _insert_key(handle._node->pair.first, [&handle]{ return handle.release(); });
+        else
+            result = _insert(std::move(handle._node->pair));
+        if(!result.second)
+            return insert_return_type{result.first, false, std::move(handle)};
+        handle.reset();
+        return insert_return_type{result.first, true, node_type{}};
+    }
     // /**
     // * @brief Erase a key from the BST.
     // * 
@@ -525,22 +2798,264 @@ class BST{
     // not needed since r value is coherent with const l value reference.
     
     /**
-     * @brief Balance the tree by copying the contents of the tree into a std::vector<> and then recursively
-     * inserting the medians of the vector into the BST.
+     * @brief Returns the height of the tree (the number of nodes of its longest path from the root), 0 if
+     * it is empty. The tree is walked in O(n) following the parent links, without extra memory.
      * 
+     * @return std::size_t
      */
-    void balance() {
-        std::vector<PairType> v;
-        v.reserve(_size);
-        for(const auto& x: *this){
-            v.emplace_back(x);
+    std::size_t height() const noexcept {
+        const node* _node = head.get();
+        std::size_t depth = _node ? 1 : 0, result = depth;
+        while(_node){
+            if(_node->left){
+                _node = _node->left.get();
+                ++depth;
+            }
+            else if(_node->right){
+                _node = _node->right.get();
+                ++depth;
+            }
+            else{
+                // _node is a leaf: go back up to the first ancestor with a right subtree not visited yet.
+                const node* from = _node;
+                for(_node = _node->parent, --depth; _node && (_node->left.get() != from || !_node->right); --depth){
+                    from = _node;
+                    _node = _node->parent;
+                }
+                if(_node){
+                    _node = _node->right.get();
+                    ++depth;
+                }
+            }
+            result = std::max(result, depth);
         }
-        /* v.reserve(_size);
-        std::uninitiliazed_copy(begin(), end(), v.begin()); */
-        clear();
-        _insert_medians(v, 0, v.size()-1);
+        return result;
+    }
+    /**
+     * @brief Returns the shape of the tree: size, height, number of leaves, mean depth of the nodes and
+     * distribution of the balance factors. The tree is walked in O(n) in post-order following the parent
+     * links, keeping the heights of the subtrees not yet joined to their parent, O(height) of them.
+     *
+     * @return tree_shape
+     */
+    tree_shape shape_report() const {
+        tree_shape shape;
+        std::vector<std::size_t> heights;
+        std::size_t depth = 1, depths = 0;
+        const node* _node = head.get();
+        // first node in post-order below _node.
+        const auto descend = [&_node, &depth]{
+            while(_node->left || _node->right){
+                _node = _node->left ? _node->left.get() : _node->right.get();
+                ++depth;
+            }
+        };
+        if(_node)
+            descend();
+        while(_node){
+            std::size_t right = 0, left = 0;
+            if(_node->right){
+                right = heights.back();
+                heights.pop_back();
+            }
+            if(_node->left){
+                left = heights.back();
+                heights.pop_back();
+            }
+            heights.push_back(std::max(left, right) + 1);
+            ++shape.balance_factors[static_cast<long>(left) - static_cast<long>(right)];
+            shape.leaves += !_node->left && !_node->right;
+            ++shape.size;
+            depths += depth;
+
+            const node* parent = _node->parent;
+            if(parent && parent->left.get() == _node && parent->right){
+                _node = parent->right.get();
+                descend();
+            }
+            else{
+                _node = parent;
+                --depth;
+            }
+        }
+        if(shape.size){
+            shape.height = heights.back();
+            shape.mean_depth = static_cast<double>(depths) / shape.size;
+        }
+        return shape;
+    }
+    /**
+     * @brief Balance the tree in O(n) by relinking its nodes into a perfectly balanced shape, without
+     * any allocation.
+     * 
+     */
+    void balance() noexcept {
+        _rebuild();
         return;
     }
+    /**
+     * @brief Balance the tree in O(n) on several threads. The nodes are gathered in order into a
+     * temporary vector (one pointer per node), then linked by independent tasks, without any allocation
+     * of nodes. If the vector cannot be allocated, the tree is left untouched.
+     * 
+     * @param policy Number of threads.
+     */
+    void balance(const parallel_policy policy) {
+        _rebuild(policy.threads);
+    }
+
+    /**
+     * @brief Call a function on every pair of the tree, on several threads. The top of the tree is split
+     * into independent subtrees, each one visited in order by one thread, hence the function is called
+     * concurrently and in no particular order. The tree must not be modified meanwhile.
+     * 
+     * @tparam Function Callable with a reference to a pair.
+     * @param function Function to be called.
+     * @param policy Number of threads.
+     */
+    template <typename Function> void parallel_for_each(Function function, const parallel_policy policy = parallel_policy{}) {
+        _parallel_visit([&function](node* const _node){ function(_node->pair); }, policy.threads);
+    }
+    /**
+     * @brief Const version of parallel_for_each(): the function is called with a const reference to a pair.
+     */
+    template <typename Function> void parallel_for_each(Function function, const parallel_policy policy = parallel_policy{}) const {
+        _parallel_visit([&function](const node* const _node){ function(static_cast<const PairType&>(_node->pair)); }, policy.threads);
+    }
+    /**
+     * @brief Split the tree by a key in O(log n): the pairs whose key is not less than key are moved,
+     * without allocating nodes, into a new tree which is returned, and this tree keeps the others.
+     * With a balancing policy both trees are balanced. Computing their sizes costs
+     * O(min(n, m)) more, unless the nodes store the size of their subtree (order_statistics).
+     * 
+     * @param key Key.
+     * @return BST Tree of the pairs whose key is not less than key.
+     */
+    BST split(const KT& key){
+        BST right{f, Alloc(alloc)};
+        const auto [less, greater, match] = _split_key(head.release(), key);
+        right.head.reset(match ? _join(nullptr, match, greater) : greater);
+        head.reset(less);
+        right._size = _count_nodes(right.head.get(), head.get(), _size);
+        _size -= right._size;
+        _reset_extremes();
+        right._reset_extremes();
+        return right;
+    }
+    /**
+     * @brief Join a tree whose keys are all greater than the keys of this tree, in O(log n), moving
+     * its nodes if the allocators are equal. right is left empty.
+     * 
+     * @param right R-value reference to BST object.
+     */
+    void join(BST&& right){
+        auto other = _adopt(std::move(right));
+        assert(!head || !other.head || f(_ends->rightmost->pair.first, other._ends->leftmost->pair.first));
+        head.reset(_join(head.release(), other.head.release()));
+        _size += other._size;
+        other._size = 0;
+        other._set_extremes(nullptr, nullptr);
+        _reset_extremes();
+    }
+    /**
+     * @brief Union with another tree, in O(m log(n/m + 1)) for balanced trees of sizes n and m <= n.
+     * The nodes of other are moved into this tree if the allocators are equal. On duplicated keys the
+     * pair of this tree is kept, and the one of other is freed. other is left empty. Without a balancing
+     * policy this tree is balanced first, in O(n).
+     * 
+     * @param other R-value reference to BST object.
+     */
+    void union_with(BST&& other){
+        auto source = _adopt(std::move(other));
+        std::size_t duplicates = 0;
+        auto discard = [this, &duplicates](node* const _node){
+            _destroy_node(_node);
+            ++duplicates;
+        };
+        _prepare_set_operation();
+        head.reset(_union(head.release(), source.head.release(), discard));
+        _size += source._size - duplicates;
+        source._size = 0;
+        source._set_extremes(nullptr, nullptr);
+        _reset_extremes();
+    }
+    /**
+     * @brief Move the pairs of another tree whose keys are not in this tree into this tree, like
+     * std::map::merge, in O(m log(n/m + 1)) for balanced trees. The pairs with duplicated keys stay
+     * in other, which is rebuilt balanced out of them in O(their number). Without a balancing policy
+     * this tree is balanced first, in O(n).
+     * 
+     * @param other Reference to BST object.
+     */
+    void merge(BST& other){
+        if(&other == this)
+            return;
+        _ensure_header();
+        if(!(alloc == other.alloc)){
+            BST source(other.cbegin(), other.cend(), f, Alloc(alloc));
+            other.clear();
+            merge(source);
+            other._build_from_sorted(source.cbegin(), source.cend());
+            return;
+        }
+        // the duplicates are met in ascending order: threading them through their left child in front
+        // of the list keeps it in descending order, as _link_medians() requires.
+        node* list = nullptr;
+        std::size_t duplicates = 0;
+        auto keep = [&list, &duplicates](node* const _node){
+            _node->left.reset(list);
+            list = _node;
+            ++duplicates;
+        };
+        _prepare_set_operation();
+        head.reset(_union(head.release(), other.head.release(), keep));
+        _size += other._size - duplicates;
+        other._size = duplicates;
+        if(list){
+            std::size_t max_depth = 0;
+            while((duplicates >> (max_depth + 1)) != 0)
+                ++max_depth;
+            other.head.reset(other._link_medians(list, duplicates, 0, max_depth));
+            other.head->parent = nullptr;
+        }
+        _reset_extremes();
+        other._reset_extremes();
+    }
+    /**
+     * @brief Intersection with another tree. The pairs of this tree whose keys are in other are kept;
+     * all the other nodes of both trees are freed. Finding the common keys takes O(m log(n/m + 1)) for
+     * balanced trees, but freeing the other nodes makes the whole operation O(n + m). other is left
+     * empty (pass a copy to keep it). Without a balancing policy this tree is balanced first, in O(n).
+     * 
+     * @param other R-value reference to BST object.
+     */
+    void intersect(BST&& other){
+        auto source = _adopt(std::move(other));
+        std::size_t count = 0;
+        _prepare_set_operation();
+        head.reset(_intersect(head.release(), source.head.release(), count));
+        _size = count;
+        source._size = 0;
+        source._set_extremes(nullptr, nullptr);
+        _reset_extremes();
+    }
+    /**
+     * @brief Remove the keys of another tree from this tree, in O(m log(n/m + 1)) for balanced trees.
+     * The removed nodes and the nodes of other are freed. other is left empty (pass a copy to keep it).
+     * Without a balancing policy this tree is balanced first, in O(n).
+     * 
+     * @param other R-value reference to BST object.
+     */
+    void difference(BST&& other){
+        auto source = _adopt(std::move(other));
+        std::size_t count = 0;
+        _prepare_set_operation();
+        head.reset(_difference(head.release(), source.head.release(), count));
+        _size -= count;
+        source._size = 0;
+        source._set_extremes(nullptr, nullptr);
+        _reset_extremes();
+    }
     /**
      * @brief Overload of operator put-to.
      * 
@@ -551,7 +3066,7 @@ class BST{
     friend std::ostream &operator<<(std::ostream &os, const BST &bst){
     if(!bst.head){
         os << "BST is empty => size: [" <<bst._size << "] ";
-        os << std::endl;
+        os << "\n";
         return os;
     }
     
@@ -559,7 +3074,7 @@ class BST{
 
     for (const auto& el : bst)
         os << el.first << " ";
-    os << std::endl;
+    os << "\n";
     return os;
   }
 
@@ -0,0 +1,149 @@
+#ifndef augment_h
+#define augment_h
+
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+#include "node.h"
+
+/**
+ * @brief Augmentation policies for the BST.
+ *
+ * An augmentation policy is a stateless struct that provides:
+ * - a `node_data` type, stored inside every node (see _node), next to the data of the balancing
+ *   policy. It summarizes the subtree rooted at the node;
+ * - `update(n)`, which recomputes the data of node n from its pair and the data of its children.
+ *
+ * The tree calls `update` on every node whose subtree has changed: on the path from an inserted or
+ * removed node up to the root, on the nodes involved in a rotation, and while rebuilding the tree.
+ *
+ * A policy whose data depends on the values, and not only on the shape of the tree, declares the
+ * `value_type` of its data: the tree then hands out the values as read only, and they are changed
+ * through the member functions which refresh the path to the root (`assign`, `update`, `insert_or_assign`).
+ */
+
+/**
+ * @brief Type trait telling whether an augmentation policy depends on the values of the nodes.
+ */
+template<typename Augment, typename = void>
+struct _aggregates_values: std::false_type{};
+template<typename Augment>
+struct _aggregates_values<Augment, std::void_t<typename Augment::value_type>>: std::true_type{};
+
+/**
+ * @brief Policy that does not augment the nodes. This is the default.
+ */
+struct no_augment{
+    /**
+     * @brief No extra data is stored in the nodes.
+     */
+    struct node_data{};
+
+    template<typename N> static void update(N* const) noexcept {}
+};
+
+/**
+ * @brief Order-statistic augmentation: every node stores the number of nodes of its subtree, so that
+ * the rank of a key, the n-th element and the number of keys within a range are found in O(height),
+ * and iterators can be advanced by k positions in O(height).
+ */
+struct order_statistics{
+    /**
+     * @brief Number of nodes of the subtree rooted at the node, the node included.
+     */
+    struct node_data{
+        std::size_t subtree_size = 1;
+    };
+
+    /**
+     * @brief Number of nodes of a (possibly empty) subtree.
+     */
+    template<typename N> static std::size_t size(const N* const n) noexcept { return n ? n->subtree_size : 0; }
+
+    template<typename N> static void update(N* const n) noexcept {
+        n->subtree_size = 1 + size(n->left.get()) + size(n->right.get());
+    }
+};
+
+/**
+ * @brief Monoid augmentation: every node caches the combination, in order, of the values of its
+ * subtree according to a user-supplied monoid, so that the aggregate of the values of the keys within
+ * a range is computed in O(height).
+ *
+ * The monoid is a default-constructible functor providing:
+ * - a `value_type`, constructible from the value type of the tree;
+ * - `identity()`, returning the identity element;
+ * - `operator()(a, b)`, an associative combination of two elements (it does not have to be commutative).
+ *
+ * See sum_monoid, min_monoid and max_monoid.
+ *
+ * @tparam M Monoid.
+ * @tparam Base Augmentation kept alongside the monoid, e.g. order_statistics. Default: no_augment.
+ */
+template<typename M, typename Base = no_augment>
+struct monoid_augment{
+    using value_type = typename M::value_type;
+
+    /**
+     * @brief Combination of the values of the subtree rooted at the node, in order.
+     */
+    struct monoid_data{
+        value_type aggregate{};
+    };
+    using node_data = _node_data<typename Base::node_data, monoid_data>;
+
+    static value_type identity() { return M{}.identity(); }
+    static value_type combine(const value_type& a, const value_type& b) { return M{}(a, b); }
+
+    /**
+     * @brief Aggregate of a (possibly empty) subtree.
+     */
+    template<typename N> static value_type summary(const N* const n) {
+        return n ? static_cast<const monoid_data&>(*n).aggregate : identity();
+    }
+
+    template<typename N> static void update(N* const n) {
+        Base::update(n);
+        static_cast<monoid_data&>(*n).aggregate =
+            combine(combine(summary(n->left.get()), value_type(n->pair.second)), summary(n->right.get()));
+    }
+};
+
+/**
+ * @brief Monoid summing the values.
+ *
+ * @tparam T Type of the values.
+ */
+template<typename T>
+struct sum_monoid{
+    using value_type = T;
+    value_type identity() const { return value_type{}; }
+    value_type operator()(const value_type& a, const value_type& b) const { return a + b; }
+};
+
+/**
+ * @brief Monoid taking the minimum of the values.
+ *
+ * @tparam T Type of the values.
+ */
+template<typename T>
+struct min_monoid{
+    using value_type = T;
+    value_type identity() const { return std::numeric_limits<T>::max(); }
+    value_type operator()(const value_type& a, const value_type& b) const { return b < a ? b : a; }
+};
+
+/**
+ * @brief Monoid taking the maximum of the values.
+ *
+ * @tparam T Type of the values.
+ */
+template<typename T>
+struct max_monoid{
+    using value_type = T;
+    value_type identity() const { return std::numeric_limits<T>::lowest(); }
+    value_type operator()(const value_type& a, const value_type& b) const { return a < b ? b : a; }
+};
+
+#endif
@@ -0,0 +1,370 @@
+#ifndef balance_h
+#define balance_h
+
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+
+#include "node.h"
+
+/**
+ * @brief Balancing policies for the BST.
+ *
+ * A balancing policy is a stateless struct that provides:
+ * - a `node_data` type, stored inside every node (see _node);
+ * - `update(n)`, which recomputes the data of node n from the data of its children. It is
+ *   called by the tree, through `tree._update(n)` which refreshes the data of the augmentation
+ *   policy as well, on every node whose subtree has changed (e.g. after a rotation);
+ * - `after_insert(tree, n)`, called once the new node n has been linked into the tree;
+ * - `before_unlink(tree, n)`, called right before a node n with at most one child is spliced out
+ *   of the tree;
+ * - `after_unlink(tree, p)`, called right after the splice, with p the former parent of the
+ *   removed node (nullptr if the removed node was the root);
+ * - `after_build(n, depth, max_depth)`, called when the tree is rebuilt into a perfectly balanced
+ *   shape, on every node n once its children have been built. depth is the depth of n and max_depth
+ *   the depth of the deepest node of the tree;
+ * - `join(tree, l, k, r)`, which links the detached node k and the detached (possibly empty) subtrees
+ *   l and r, whose keys are respectively less and greater than the key of k, into one balanced tree,
+ *   and stores its root into the head of the tree, which must be empty. It runs in O(|height(l) - height(r)| + 1),
+ *   and is the building block of split and of the set operations of the tree.
+ *
+ * The policies rely on the rotations provided by the BST, which declares them as friends.
+ */
+
+/**
+ * @brief Policy that never rebalances the tree. This is the original behaviour of the BST.
+ */
+struct no_balance{
+    /**
+     * @brief No extra data is stored in the nodes.
+     */
+    using node_data = _no_node_data;
+
+    template<typename N> static void update(N* const) noexcept {}
+    template<typename Tree, typename N> static void after_insert(Tree&, N* const) noexcept {}
+    template<typename Tree, typename N> static void before_unlink(Tree&, N* const) noexcept {}
+    template<typename Tree, typename N> static void after_unlink(Tree&, N* const) noexcept {}
+    template<typename N> static void after_build(N* const, const std::size_t, const std::size_t) noexcept {}
+
+    /**
+     * @brief k simply becomes the root, with l and r as children.
+     */
+    template<typename Tree, typename N> static void join(Tree& tree, N* const l, N* const k, N* const r) noexcept {
+        tree._link(k, l, r);
+        tree.head.reset(k);
+    }
+};
+
+/**
+ * @brief AVL balancing policy. Every node stores the height of its subtree and, after each
+ * insertion or removal, the path from the modified node up to the root is retraced rotating
+ * wherever the heights of the two subtrees differ by more than one.
+ * The height of the tree is at most ~1.44 log2(n).
+ */
+struct avl_balance{
+    /**
+     * @brief Height of the subtree rooted at the node. A leaf has height 1.
+     */
+    struct node_data{
+        int height = 1;
+    };
+
+    /**
+     * @brief Height of a (possibly empty) subtree.
+     */
+    template<typename N> static int height(const N* const n) noexcept { return n ? n->height : 0; }
+
+    template<typename N> static void update(N* const n) noexcept {
+        n->height = 1 + std::max(height(n->left.get()), height(n->right.get()));
+    }
+
+    template<typename Tree, typename N> static void after_insert(Tree& tree, N* const n) noexcept {
+        retrace(tree, n->parent);
+    }
+
+    template<typename Tree, typename N> static void before_unlink(Tree&, N* const) noexcept {}
+
+    template<typename Tree, typename N> static void after_unlink(Tree& tree, N* const parent) noexcept {
+        retrace(tree, parent);
+    }
+
+    template<typename N> static void after_build(N* const n, const std::size_t, const std::size_t) noexcept {
+        update(n);
+    }
+
+    /**
+     * @brief If the heights of l and r differ by at most one, k becomes the root. Otherwise k is linked
+     * with r (l) in place of the first node c along the right (left) spine of the taller tree whose
+     * height is at most one more than the one of the shorter tree, and the path above it is retraced
+     * like after an insertion, since the subtree rooted at k is at most one level taller than c.
+     */
+    template<typename Tree, typename N> static void join(Tree& tree, N* const l, N* const k, N* const r) noexcept {
+        if(height(l) > height(r) + 1){
+            N* parent = nullptr;
+            auto c = l;
+            while(height(c) > height(r) + 1){
+                parent = c;
+                c = c->right.get();
+            }
+            parent->right.release();
+            tree._link(k, c, r);
+            parent->right.reset(k);
+            k->parent = parent;
+            tree.head.reset(l);
+            retrace(tree, parent);
+        }
+        else if(height(r) > height(l) + 1){
+            N* parent = nullptr;
+            auto c = r;
+            while(height(c) > height(l) + 1){
+                parent = c;
+                c = c->left.get();
+            }
+            parent->left.release();
+            tree._link(k, l, c);
+            parent->left.reset(k);
+            k->parent = parent;
+            tree.head.reset(r);
+            retrace(tree, parent);
+        }
+        else{
+            tree._link(k, l, r);
+            tree.head.reset(k);
+        }
+    }
+
+    /**
+     * @brief Walk from n up to the root, refreshing the heights and rotating every
+     * node that became unbalanced.
+     *
+     * @param tree The tree being rebalanced.
+     * @param n First node to be checked.
+     */
+    template<typename Tree, typename N> static void retrace(Tree& tree, N* n) noexcept {
+        while(n){
+            tree._update(n);
+            const auto balance_factor = height(n->left.get()) - height(n->right.get());
+            if(balance_factor > 1){
+                // left-right case: reduce it to the left-left case first.
+                if(height(n->left->left.get()) < height(n->left->right.get()))
+                    tree._rotate_left(n->left.get());
+                n = tree._rotate_right(n);
+            }
+            else if(balance_factor < -1){
+                // right-left case: reduce it to the right-right case first.
+                if(height(n->right->right.get()) < height(n->right->left.get()))
+                    tree._rotate_right(n->right.get());
+                n = tree._rotate_left(n);
+            }
+            n = n->parent;
+        }
+    }
+};
+
+/**
+ * @brief Red-black balancing policy. Every node stores its color. The usual invariants
+ * (the root is black, a red node has no red children, every path from a node to its
+ * leaves contains the same number of black nodes) keep the height of the tree below
+ * 2 log2(n+1). At most three rotations are performed per update.
+ */
+struct red_black_balance{
+    /**
+     * @brief Color of the node. Newly allocated nodes are red.
+     */
+    struct node_data{
+        bool red = true;
+    };
+
+    /**
+     * @brief Color of a (possibly empty) subtree. Empty subtrees are black.
+     */
+    template<typename N> static bool is_red(const N* const n) noexcept { return n && n->red; }
+
+    template<typename N> static void update(N* const) noexcept {}
+
+    template<typename Tree, typename N> static void after_insert(Tree& tree, N* n) noexcept {
+        n->red = true;
+        while(n->parent && n->parent->red){
+            auto parent = n->parent;
+            // the parent is red, hence it is not the root and the grandparent exists.
+            auto grandparent = parent->parent;
+            if(parent == grandparent->left.get()){
+                auto uncle = grandparent->right.get();
+                if(is_red(uncle)){
+                    parent->red = uncle->red = false;
+                    grandparent->red = true;
+                    n = grandparent;
+                    continue;
+                }
+                if(n == parent->right.get()){
+                    tree._rotate_left(parent);
+                    n = parent;
+                    parent = n->parent;
+                }
+                parent->red = false;
+                grandparent->red = true;
+                tree._rotate_right(grandparent);
+            }
+            else{
+                auto uncle = grandparent->left.get();
+                if(is_red(uncle)){
+                    parent->red = uncle->red = false;
+                    grandparent->red = true;
+                    n = grandparent;
+                    continue;
+                }
+                if(n == parent->left.get()){
+                    tree._rotate_right(parent);
+                    n = parent;
+                    parent = n->parent;
+                }
+                parent->red = false;
+                grandparent->red = true;
+                tree._rotate_left(grandparent);
+            }
+        }
+        tree.head->red = false;
+    }
+
+    /**
+     * @brief Restore the invariants before a node with at most one child is removed.
+     * A red node can be removed as is. A black node with a child has a red child, which
+     * takes its place and is painted black. A black leaf is treated as a "double black"
+     * node and fixed in place: the rotations never give it children, so it can
+     * be spliced out afterwards.
+     *
+     * @param tree The tree being rebalanced.
+     * @param n Node that is about to be removed.
+     */
+    template<typename Tree, typename N> static void before_unlink(Tree& tree, N* n) noexcept {
+        if(n->red)
+            return;
+        if(n->left || n->right){
+            (n->left ? n->left : n->right)->red = false;
+            return;
+        }
+        while(n->parent && !n->red){
+            auto parent = n->parent;
+            if(n == parent->left.get()){
+                // the sibling exists since n is black.
+                auto sibling = parent->right.get();
+                if(sibling->red){
+                    sibling->red = false;
+                    parent->red = true;
+                    tree._rotate_left(parent);
+                    sibling = parent->right.get();
+                }
+                if(!is_red(sibling->left.get()) && !is_red(sibling->right.get())){
+                    sibling->red = true;
+                    n = parent;
+                    continue;
+                }
+                if(!is_red(sibling->right.get())){
+                    sibling->left->red = false;
+                    sibling->red = true;
+                    tree._rotate_right(sibling);
+                    sibling = parent->right.get();
+                }
+                sibling->red = parent->red;
+                parent->red = false;
+                sibling->right->red = false;
+                tree._rotate_left(parent);
+                return;
+            }
+            else{
+                auto sibling = parent->left.get();
+                if(sibling->red){
+                    sibling->red = false;
+                    parent->red = true;
+                    tree._rotate_right(parent);
+                    sibling = parent->left.get();
+                }
+                if(!is_red(sibling->left.get()) && !is_red(sibling->right.get())){
+                    sibling->red = true;
+                    n = parent;
+                    continue;
+                }
+                if(!is_red(sibling->left.get())){
+                    sibling->right->red = false;
+                    sibling->red = true;
+                    tree._rotate_left(sibling);
+                    sibling = parent->left.get();
+                }
+                sibling->red = parent->red;
+                parent->red = false;
+                sibling->left->red = false;
+                tree._rotate_right(parent);
+                return;
+            }
+        }
+        n->red = false;
+    }
+
+    template<typename Tree, typename N> static void after_unlink(Tree&, N* const) noexcept {}
+
+    /**
+     * @brief Number of black nodes on the paths from n down to its empty subtrees, n included.
+     */
+    template<typename N> static std::size_t black_height(const N* n) noexcept {
+        std::size_t height = 0;
+        for(; n; n = n->left.get())
+            height += !n->red;
+        return height;
+    }
+
+    /**
+     * @brief The roots of l and r are painted black. If their black heights are equal, k becomes the
+     * black root. Otherwise k is painted red and linked with r (l) in place of the first black node c
+     * along the right (left) spine of the tree with the greater black height whose black height is the
+     * one of the other tree. This keeps the black heights, and a red parent of k is fixed like after an insertion.
+     */
+    template<typename Tree, typename N> static void join(Tree& tree, N* const l, N* const k, N* const r) noexcept {
+        if(l)
+            l->red = false;
+        if(r)
+            r->red = false;
+        const auto lh = black_height(l);
+        const auto rh = black_height(r);
+        if(lh == rh){
+            tree._link(k, l, r);
+            k->red = false;
+            tree.head.reset(k);
+            return;
+        }
+        const bool left_taller = lh > rh;
+        auto c = left_taller ? l : r;
+        auto h = left_taller ? lh : rh;
+        const auto target = left_taller ? rh : lh;
+        N* parent = nullptr;
+        while(is_red(c) || h != target){
+            h -= !c->red;
+            parent = c;
+            c = left_taller ? c->right.get() : c->left.get();
+        }
+        if(left_taller){
+            parent->right.release();
+            tree._link(k, c, r);
+            parent->right.reset(k);
+        }
+        else{
+            parent->left.release();
+            tree._link(k, l, c);
+            parent->left.reset(k);
+        }
+        k->parent = parent;
+        tree.head.reset(left_taller ? l : r);
+        tree._update_path(k);
+        after_insert(tree, k);
+    }
+
+    /**
+     * @brief In a perfectly balanced tree all the empty subtrees are at depth max_depth or
+     * max_depth+1, hence painting red the deepest nodes (but the root) and black all the others
+     * gives the same number of black nodes on every path.
+     */
+    template<typename N> static void after_build(N* const n, const std::size_t depth, const std::size_t max_depth) noexcept {
+        n->red = depth == max_depth && depth > 0;
+    }
+};
+
+#endif
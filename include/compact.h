@@ -0,0 +1,592 @@
+#ifndef compact_h
+#define compact_h
+
+#include <iostream>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Node of a compact_BST. Nodes are stored in one array and refer to their children by their
+ * 32-bit position in it; the color of the node is packed with the right child. There is no parent
+ * link: for a BST<int, int> this takes 16 bytes per node instead of 32, or 40 with a balancing policy.
+ *
+ * @tparam KT Key type.
+ * @tparam VT Value type.
+ */
+template<typename KT, typename VT>
+struct _compact_node{
+    // position of a missing child. Positions take 31 bits, hence a tree holds less than 2^31 nodes.
+    static constexpr std::uint32_t null = 0x7fffffff;
+
+    std::pair<const KT, VT> pair;
+    std::uint32_t left;
+    std::uint32_t right: 31;
+    // color of the link from the parent: red links lean left and are never consecutive.
+    std::uint32_t red: 1;
+
+    /**
+     * @brief Construct a red leaf whose pair is constructed in place from the given arguments.
+     */
+    template <typename ... Types>
+    explicit _compact_node(std::in_place_t, Types&& ... args):
+        pair(std::forward<Types>(args)...), left{null}, right{null}, red{1} {}
+};
+
+/**
+ * @brief Bidirectional iterator over a compact_BST. Nodes have no parent link, hence the iterator
+ * keeps the path from the root to its node, which is never longer than the maximum height of the tree,
+ * on a stack of fixed size: iterators never allocate, and advancing takes amortized O(1).
+ *
+ * @tparam N Node type (const for the const iterator).
+ * @tparam O Value type that the iterator points to.
+ */
+template<typename N, typename O>
+class _compact_iterator{
+    // a red-black tree of less than 2^31 nodes is at most 2*31 levels high.
+    static constexpr std::size_t _max_height = 64;
+    static constexpr std::uint32_t null = N::null;
+
+    N* nodes;
+    std::uint32_t root;
+    // path[0] is the root, path[depth-1] the current node. The end iterator has an empty path.
+    std::uint32_t depth;
+    std::uint32_t path[_max_height];
+
+    void push(const std::uint32_t n) noexcept { path[depth++] = n; }
+    /**
+     * @brief Push the leftmost (rightmost) path of a subtree on the stack.
+     */
+    void descend_left(std::uint32_t n) noexcept {
+        for(; n != null; n = nodes[n].left)
+            push(n);
+    }
+    void descend_right(std::uint32_t n) noexcept {
+        for(; n != null; n = nodes[n].right)
+            push(n);
+    }
+
+    template <typename KT, typename VT, typename F> friend class compact_BST;
+
+    public:
+    using value_type = O;
+    using reference = value_type &;
+    using pointer = value_type *;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::bidirectional_iterator_tag;
+
+    /**
+     * @brief Construct the end iterator of the tree stored in nodes, rooted at root.
+     */
+    explicit _compact_iterator(N* nodes = nullptr, const std::uint32_t root = null) noexcept:
+        nodes{nodes}, root{root}, depth{0} {}
+
+    reference operator*() const noexcept { return nodes[path[depth-1]].pair; }
+    pointer operator->() const noexcept { return &**this; }
+
+    _compact_iterator& operator++() noexcept {
+        const auto n = path[depth-1];
+        if(nodes[n].right != null){
+            descend_left(nodes[n].right);
+            return *this;
+        }
+        // climb up to the first ancestor whose left subtree holds the node.
+        std::uint32_t child;
+        do{
+            child = path[--depth];
+        }while(depth && nodes[path[depth-1]].left != child);
+        return *this;
+    }
+    _compact_iterator operator++(int) noexcept {
+        auto old = *this;
+        ++(*this);
+        return old;
+    }
+    /**
+     * @brief Overload pre decrement operator--(). Decrementing the end iterator of a non-empty tree
+     * gives its last pair.
+     */
+    _compact_iterator& operator--() noexcept {
+        if(!depth){
+            descend_right(root);
+            return *this;
+        }
+        const auto n = path[depth-1];
+        if(nodes[n].left != null){
+            descend_right(nodes[n].left);
+            return *this;
+        }
+        std::uint32_t child;
+        do{
+            child = path[--depth];
+        }while(depth && nodes[path[depth-1]].right != child);
+        return *this;
+    }
+    _compact_iterator operator--(int) noexcept {
+        auto old = *this;
+        --(*this);
+        return old;
+    }
+
+    friend bool operator==(const _compact_iterator& a, const _compact_iterator& b) noexcept {
+        return a.depth ? b.depth && a.path[a.depth-1] == b.path[b.depth-1] : !b.depth;
+    }
+    friend bool operator!=(const _compact_iterator& a, const _compact_iterator& b) noexcept { return !(a == b); }
+};
+
+/**
+ * @brief Compact binary search tree: a left-leaning red-black tree whose nodes are stored contiguously
+ * in one array, with 32-bit links and no parent link.
+ *
+ * A BST node holds three 8-byte pointers and its balancing data besides the pair, and is allocated
+ * on its own. Here the nodes of the tree are the elements of a std::vector, so they cost no allocation
+ * each, children are referred to by their position and the color bit is packed with the right child.
+ * Erasing a node moves the last node of the array into its place, so the array never has holes.
+ *
+ * The price is paid by the iterators, which keep the path from the root to their node, and by their
+ * validity: any insertion or erasure invalidates all of them, as the array may be reallocated or
+ * compacted.
+ *
+ * @tparam KT Key type.
+ * @tparam VT Value type.
+ * @tparam F Type of comparison operator. Default: std::less<const KT>.
+ */
+template<typename KT, typename VT, typename F = std::less<const KT>>
+class compact_BST{
+    using PairType = std::pair<const KT, VT>; // Pair Type
+    using node = _compact_node<KT, VT>;
+    using iterator = _compact_iterator<node, PairType>;
+    using const_iterator = _compact_iterator<const node, const PairType>;
+    static constexpr std::uint32_t null = node::null;
+
+    F f;
+    std::vector<node> nodes;
+    std::uint32_t root{null};
+
+    bool _red(const std::uint32_t n) const noexcept { return n != null && nodes[n].red; }
+
+    /**
+     * @brief Helper functions rotating the subtree rooted at h, keeping the color of its root.
+     * Return the new root.
+     */
+    std::uint32_t _rotate_left(const std::uint32_t h) noexcept {
+        const std::uint32_t x = nodes[h].right;
+        nodes[h].right = nodes[x].left;
+        nodes[x].left = h;
+        nodes[x].red = nodes[h].red;
+        nodes[h].red = 1;
+        return x;
+    }
+    std::uint32_t _rotate_right(const std::uint32_t h) noexcept {
+        const std::uint32_t x = nodes[h].left;
+        nodes[h].left = nodes[x].right;
+        nodes[x].right = h;
+        nodes[x].red = nodes[h].red;
+        nodes[h].red = 1;
+        return x;
+    }
+    void _flip(const std::uint32_t h) noexcept {
+        nodes[h].red ^= 1;
+        nodes[nodes[h].left].red ^= 1;
+        nodes[nodes[h].right].red ^= 1;
+    }
+    /**
+     * @brief Helper function restoring the invariants (red links lean left, no two consecutive red
+     * links) at the root of a subtree on the way up. Returns the new root.
+     */
+    std::uint32_t _fix_up(std::uint32_t h) noexcept {
+        if(_red(nodes[h].right) && !_red(nodes[h].left))
+            h = _rotate_left(h);
+        if(_red(nodes[h].left) && _red(nodes[nodes[h].left].left))
+            h = _rotate_right(h);
+        if(_red(nodes[h].left) && _red(nodes[h].right))
+            _flip(h);
+        return h;
+    }
+    /**
+     * @brief Helper functions making the left (right) child of h, or one of its children, red before
+     * descending into it, so that the node to be erased is never a black leaf. Return the new root.
+     */
+    std::uint32_t _move_red_left(std::uint32_t h) noexcept {
+        _flip(h);
+        if(_red(nodes[nodes[h].right].left)){
+            nodes[h].right = _rotate_right(nodes[h].right);
+            h = _rotate_left(h);
+            _flip(h);
+        }
+        return h;
+    }
+    std::uint32_t _move_red_right(std::uint32_t h) noexcept {
+        _flip(h);
+        if(_red(nodes[nodes[h].left].left)){
+            h = _rotate_right(h);
+            _flip(h);
+        }
+        return h;
+    }
+
+    /**
+     * @brief Helper function inserting a key in the subtree rooted at h. The node is appended to the
+     * array by create, called only once the key is known not to be present. Returns the new root.
+     *
+     * @param h Root of the subtree.
+     * @param key Key to be inserted.
+     * @param create Function appending the new node to the array.
+     * @param position Set to the position of the node with the key.
+     * @param inserted Set to true if the node was inserted.
+     */
+    template <typename K, typename Create>
+    std::uint32_t _insert(const std::uint32_t h, const K& key, Create& create, std::uint32_t& position, bool& inserted){
+        if(h == null){
+            create();
+            inserted = true;
+            return position = static_cast<std::uint32_t>(nodes.size() - 1);
+        }
+        // the array may be reallocated below: nodes[h] is looked up again afterwards.
+        if(f(key, nodes[h].pair.first))
+            nodes[h].left = _insert(nodes[h].left, key, create, position, inserted);
+        else if(f(nodes[h].pair.first, key))
+            nodes[h].right = _insert(nodes[h].right, key, create, position, inserted);
+        else{
+            position = h;
+            return h;
+        }
+        return _fix_up(h);
+    }
+    /**
+     * @brief Helper function detaching the leftmost node of the subtree rooted at h, whose left child
+     * or one of its children must be red. Returns the new root.
+     *
+     * @param min Set to the position of the detached node.
+     */
+    std::uint32_t _detach_min(std::uint32_t h, std::uint32_t& min) noexcept {
+        if(nodes[h].left == null){
+            // the right child is missing as well, since red links lean left.
+            min = h;
+            return null;
+        }
+        if(!_red(nodes[h].left) && !_red(nodes[nodes[h].left].left))
+            h = _move_red_left(h);
+        nodes[h].left = _detach_min(nodes[h].left, min);
+        return _fix_up(h);
+    }
+    /**
+     * @brief Helper function detaching the node with a given key, which must be present, from the
+     * subtree rooted at h. Returns the new root.
+     *
+     * @param h Root of the subtree.
+     * @param key Key to be erased.
+     * @param erased Set to the position of the detached node.
+     */
+    template <typename K> std::uint32_t _detach(std::uint32_t h, const K& key, std::uint32_t& erased){
+        if(f(key, nodes[h].pair.first)){
+            if(!_red(nodes[h].left) && !_red(nodes[nodes[h].left].left))
+                h = _move_red_left(h);
+            nodes[h].left = _detach(nodes[h].left, key, erased);
+            return _fix_up(h);
+        }
+        if(_red(nodes[h].left))
+            h = _rotate_right(h);
+        if(!f(nodes[h].pair.first, key) && nodes[h].right == null){
+            erased = h;
+            return null;
+        }
+        if(!_red(nodes[h].right) && !_red(nodes[nodes[h].right].left))
+            h = _move_red_right(h);
+        if(f(nodes[h].pair.first, key)){
+            nodes[h].right = _detach(nodes[h].right, key, erased);
+            return _fix_up(h);
+        }
+        // the successor of h takes its place: pairs never move between nodes.
+        std::uint32_t min;
+        const auto right = _detach_min(nodes[h].right, min);
+        nodes[min].left = nodes[h].left;
+        nodes[min].right = right;
+        nodes[min].red = nodes[h].red;
+        erased = h;
+        return _fix_up(min);
+    }
+    /**
+     * @brief Helper function destroying a detached node. The last node of the array is moved into its
+     * place, and the link to it, found by descending with its key, is updated.
+     *
+     * @param hole Position of the detached node.
+     */
+    void _release(const std::uint32_t hole){
+        const auto last = static_cast<std::uint32_t>(nodes.size() - 1);
+        if(hole != last){
+            const auto& key = nodes[last].pair.first;
+            std::uint32_t parent = null, n = root;
+            bool left = false;
+            while(n != last){
+                parent = n;
+                left = f(key, nodes[n].pair.first);
+                n = left ? nodes[n].left : nodes[n].right;
+            }
+            if(parent == null)
+                root = hole;
+            else if(left)
+                nodes[parent].left = hole;
+            else
+                nodes[parent].right = hole;
+            // pairs have a const key, hence the node is moved by destroying and constructing in place.
+            std::destroy_at(&nodes[hole]);
+            ::new(static_cast<void*>(&nodes[hole])) node(std::move(nodes[last]));
+        }
+        nodes.pop_back();
+    }
+
+    /**
+     * @brief Helper function returning the position of the node with the given key, null if it is not present.
+     *
+     * @tparam K Type comparable with the key type.
+     * @param key Key to be searched.
+     */
+    template <typename K> std::uint32_t _find(const K& key) const noexcept {
+        auto n = root;
+        while(n != null){
+            if(f(key, nodes[n].pair.first))
+                n = nodes[n].left;
+            else if(f(nodes[n].pair.first, key))
+                n = nodes[n].right;
+            else
+                return n;
+        }
+        return null;
+    }
+    /**
+     * @brief Helper function returning an iterator to the node at a given position, or end() for null,
+     * descending from the root with the key of the node to record the path to it.
+     *
+     * @tparam I iterator or const_iterator.
+     * @param it End iterator of the tree.
+     * @param position Position of the node.
+     */
+    template <typename I> I _iterator_to(I it, const std::uint32_t position) const noexcept {
+        if(position == null)
+            return it;
+        const auto& key = nodes[position].pair.first;
+        auto n = root;
+        for(it.push(n); n != position; it.push(n))
+            n = f(key, nodes[n].pair.first) ? nodes[n].left : nodes[n].right;
+        return it;
+    }
+    /**
+     * @brief Helper function implementing insert() and emplace().
+     *
+     * @param key Key of the pair.
+     * @param create Function appending the node of the pair to the array.
+     * @return std::pair<iterator, bool> Iterator to the pair with the key, and true if it was inserted.
+     */
+    template <typename K, typename Create> std::pair<iterator, bool> _insert_key(const K& key, Create&& create){
+        if(nodes.size() >= null)
+            throw std::length_error{"compact_BST cannot hold more than 2^31 - 1 pairs."};
+        std::uint32_t position = null;
+        bool inserted = false;
+        root = _insert(root, key, create, position, inserted);
+        nodes[root].red = 0;
+        return {_iterator_to(end(), position), inserted};
+    }
+    /**
+     * @brief Helper function implementing erase().
+     */
+    template <typename K> bool _erase(const K& key){
+        if(_find(key) == null)
+            return false;
+        // the root is made red if both its children are black, so that the invariant of _detach holds.
+        if(!_red(nodes[root].left) && !_red(nodes[root].right))
+            nodes[root].red = 1;
+        std::uint32_t erased = null;
+        root = _detach(root, key, erased);
+        if(root != null)
+            nodes[root].red = 0;
+        _release(erased);
+        return true;
+    }
+
+    public:
+
+    /**
+     * @brief Construct an empty tree.
+     *
+     * @param f Comparison operator.
+     */
+    explicit compact_BST(F f = F{}): f{f} {}
+    /**
+     * @brief Construct a tree holding the pairs of a range (e.g. of a BST). Duplicated keys are skipped,
+     * keeping the first pair.
+     *
+     * @tparam It Input iterator.
+     * @param first Iterator to the first pair.
+     * @param last Iterator past the last pair.
+     * @param f Comparison operator.
+     */
+    template <typename It>
+    compact_BST(It first, It last, F f = F{}): f{f} {
+        if constexpr (std::is_base_of<std::forward_iterator_tag, typename std::iterator_traits<It>::iterator_category>::value)
+            nodes.reserve(static_cast<std::size_t>(std::distance(first, last)));
+        for(; first != last; ++first)
+            insert(*first);
+    }
+
+    /**
+     * @brief Insert a <key,value> pair in the tree.
+     *
+     * @param pair Pair to be inserted.
+     * @return std::pair<iterator, bool> Iterator to the pair with the key, and true if it was inserted,
+     * false if the key was already present.
+     */
+    std::pair<iterator, bool> insert(const PairType& pair){
+        return _insert_key(pair.first, [this, &pair]{ nodes.emplace_back(std::in_place, pair); });
+    }
+    std::pair<iterator, bool> insert(PairType&& pair){
+        return _insert_key(pair.first, [this, &pair]{ nodes.emplace_back(std::in_place, std::move(pair)); });
+    }
+    /**
+     * @brief Insert a pair constructed in place from the given arguments.
+     *
+     * @param args Arguments of the constructor of the pair.
+     * @return std::pair<iterator, bool> Same as insert().
+     */
+    template<class... Types>
+    std::pair<iterator, bool> emplace(Types&& ... args) { return insert(PairType{std::forward<Types>(args)...}); }
+
+    /**
+     * @brief Erase the pair with a given key. The last node of the array is moved into its place.
+     *
+     * @param key Key to be erased.
+     * @return bool true if the key was present.
+     */
+    bool erase(const KT& key) { return _erase(key); }
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    bool erase(const K& key) { return _erase(key); }
+
+    /**
+     * @brief Empty the tree, keeping the capacity of the array.
+     */
+    void clear() noexcept {
+        nodes.clear();
+        root = null;
+    }
+    /**
+     * @brief Reserve room for a given number of pairs, so that inserting them does not reallocate the array.
+     */
+    void reserve(const std::size_t n) { nodes.reserve(n); }
+    /**
+     * @brief Shrink the array to the number of pairs of the tree.
+     */
+    void shrink_to_fit() { nodes.shrink_to_fit(); }
+
+    /**
+     * @brief Returns the number of pairs of the tree.
+     *
+     * @return std::size_t
+     */
+    std::size_t size() const noexcept { return nodes.size(); }
+    bool empty() const noexcept { return nodes.empty(); }
+    /**
+     * @brief Returns the number of bytes of the array of nodes, unused capacity included. No other
+     * memory is allocated by the tree.
+     *
+     * @return std::size_t
+     */
+    std::size_t memory() const noexcept { return nodes.capacity() * sizeof(node); }
+    /**
+     * @brief Returns the height of the tree, 0 if it is empty. Computed in O(n).
+     *
+     * @return std::size_t
+     */
+    std::size_t height() const {
+        std::size_t result = 0;
+        for(auto it = begin(); it != end(); ++it)
+            if(nodes[it.path[it.depth-1]].left == null && nodes[it.path[it.depth-1]].right == null)
+                result = std::max<std::size_t>(result, it.depth);
+        return result;
+    }
+
+    /**
+     * @brief Finds a given key. If the key is present, returns an iterator to the proper pair,
+     * end() otherwise.
+     *
+     * @param key Key to be found.
+     * @return iterator
+     */
+    iterator find(const KT& key) noexcept { return _iterator_to(end(), _find(key)); }
+    const_iterator find(const KT& key) const noexcept { return _iterator_to(end(), _find(key)); }
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    iterator find(const K& key) noexcept { return _iterator_to(end(), _find(key)); }
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    const_iterator find(const K& key) const noexcept { return _iterator_to(end(), _find(key)); }
+    /**
+     * @brief Returns the number of pairs with the given key, i.e., 1 if the key is present and 0 otherwise.
+     *
+     * @param key
+     * @return std::size_t
+     */
+    std::size_t count(const KT& key) const noexcept { return _find(key) != null; }
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    std::size_t count(const K& key) const noexcept { return _find(key) != null; }
+    /**
+     * @brief Returns true if the key is present in the tree, false otherwise.
+     *
+     * @param key
+     * @return bool
+     */
+    bool contains(const KT& key) const noexcept { return _find(key) != null; }
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    bool contains(const K& key) const noexcept { return _find(key) != null; }
+
+    /**
+     * @brief Returns iterator to the beginning of the tree.
+     *
+     * @return iterator
+     */
+    iterator begin() noexcept {
+        iterator it = end();
+        it.descend_left(root);
+        return it;
+    }
+    const_iterator begin() const noexcept {
+        const_iterator it = end();
+        it.descend_left(root);
+        return it;
+    }
+    const_iterator cbegin() const noexcept { return begin(); }
+    /**
+     * @brief Returns iterator to end of the tree.
+     *
+     * @return iterator
+     */
+    iterator end() noexcept { return iterator{nodes.data(), root}; }
+    const_iterator end() const noexcept { return const_iterator{nodes.data(), root}; }
+    const_iterator cend() const noexcept { return end(); }
+
+    /**
+     * @brief Overload of operator put-to. Same format as the one of BST.
+     *
+     * @param os Reference to std::ostream.
+     * @param tree Const reference to the tree.
+     * @return std::ostream&
+     */
+    friend std::ostream &operator<<(std::ostream &os, const compact_BST &tree){
+        if(tree.empty()){
+            os << "BST is empty => size: [0] \n";
+            return os;
+        }
+        os << "size: [" << tree.size() << "] ";
+        for(const auto& el : tree)
+            os << el.first << " ";
+        os << "\n";
+        return os;
+    }
+};
+
+#endif
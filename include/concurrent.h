@@ -0,0 +1,620 @@
+#ifndef concurrent_h
+#define concurrent_h
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "epoch.h"
+
+/**
+ * @brief Links of a node of a concurrent_BST, also used as the sentinel above the root.
+ *
+ * The children are atomic pointers, so that readers can follow them while writers relink them.
+ * Every node is a seqlock: its version is even while the links are stable, and a writer makes it
+ * odd while it changes them. A node which has been unlinked from the tree keeps an odd version
+ * forever. Writers serialize on the per-node mutex. The height of the subtree is only a hint for
+ * the relaxed balancing: it is updated under the lock of the node, but read without it.
+ *
+ * @tparam N Type of the nodes.
+ */
+template<typename N>
+struct _concurrent_links{
+    std::atomic<N*> left{nullptr};
+    std::atomic<N*> right{nullptr};
+    std::atomic<std::uint64_t> version{0};
+    std::atomic<int> height{1};
+    std::mutex lock;
+};
+
+/**
+ * @brief Node of a concurrent_BST. The pair never changes once the node has been created.
+ *
+ * @tparam KT Key type.
+ * @tparam VT Value type.
+ */
+template<typename KT, typename VT>
+struct _concurrent_node: _concurrent_links<_concurrent_node<KT, VT>>{
+    std::pair<const KT, VT> pair;
+
+    template<typename ... Types>
+    explicit _concurrent_node(Types&& ... args): pair{std::forward<Types>(args)...} {}
+};
+
+/**
+ * @brief Thread-safe binary search tree, which can be used by any number of threads at once.
+ *
+ * Readers (find, count, contains, for_each) take no lock: they descend optimistically, validating every
+ * link they follow against the version of its node, and restart from the root if a writer changed
+ * the node in the meantime. Writers (insert, erase) locate their position in the same way, then lock
+ * only the few nodes they relink, top-down, and validate them again.
+ *
+ * The keys of the nodes never move, so that a reader is never misled by a concurrent removal: a node
+ * with at most one child is spliced out, while a node with two children is replaced by a new copy of
+ * its successor, linked in before the successor is spliced out.
+ *
+ * The tree is kept balanced by relaxed AVL balancing, in the style of Bronson et al.: every node stores
+ * the height of its subtree and, after an insertion or a removal, the writer walks back up the path
+ * recomputing the heights and rotating where they differ by more than one, each step under the locks
+ * of the few nodes it relinks, taken top-down. A step which finds its nodes changed by another writer
+ * stops the walk, so the tree may be briefly out of balance while writers contend, but sorted keys
+ * (e.g. timestamps) keep O(log n) operations. A rotation changes the version of every node it relinks,
+ * and readers validate every node again after stepping to its child, so they restart rather than
+ * follow a subtree which no longer holds their key.
+ *
+ * Unlinked nodes may still be visited by readers, hence they are not freed at once: every operation
+ * is pinned to an epoch, and the nodes unlinked by erase() are retired and freed once no operation
+ * which could be visiting them is still running (see epoch_domain). This suits read-mostly workloads,
+ * where readers scale with the number of cores since they never write to shared memory but their own
+ * epoch slot.
+ *
+ * @tparam KT Key type.
+ * @tparam VT Value type. Values are copied out by find().
+ * @tparam F Type of comparison operator. Default: std::less<const KT>.
+ */
+template<typename KT, typename VT, typename F = std::less<const KT>>
+class concurrent_BST{
+    using PairType = std::pair<const KT, VT>; // Pair Type
+    using node = _concurrent_node<KT, VT>;
+    using links = _concurrent_links<node>;
+
+    /**
+     * @brief Result of a descent: the node with the key (nullptr if not found), the last links visited
+     * before it, the side of those links where the node is (or would be linked), and their version.
+     */
+    struct location{
+        node* _node;
+        links* parent;
+        bool right;
+        std::uint64_t version;
+    };
+
+    F f;
+    // sentinel above the tree: the root is its left child. mutable, since readers descend from it.
+    mutable links _head;
+    std::atomic<std::size_t> _size{0};
+    // epochs of the running operations and unlinked nodes waiting to be freed.
+    mutable epoch_domain<node> _domain;
+
+    /**
+     * @brief Helper function returning the left or right child link of a node.
+     */
+    static std::atomic<node*>& _child(links* const n, const bool right) noexcept {
+        return right ? n->right : n->left;
+    }
+    /**
+     * @brief Helper function called by a writer, holding the lock of a node, before relinking it.
+     */
+    static void _begin_write(links* const n) noexcept {
+        n->version.store(n->version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    /**
+     * @brief Helper function called by a writer, holding the lock of a node, after relinking it.
+     */
+    static void _end_write(links* const n) noexcept {
+        n->version.store(n->version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    /**
+     * @brief Helper function to mark an unlinked node: its version stays odd forever, so that the
+     * readers standing on it restart.
+     */
+    static void _mark_unlinked(links* const n) noexcept { _begin_write(n); }
+
+    /**
+     * @brief Helper function to step from a node to its child during a descent: reads the version of the
+     * child, then checks that the node has not changed since the child was read, so that the child was
+     * still in place, and its subtree still held the key, when its version was read.
+     *
+     * @param parent Node the descent stands on, updated to the child.
+     * @param version Version of parent, updated to the one of the child.
+     * @param child Child of parent read under version.
+     * @return bool false if the descent must be restarted.
+     */
+    static bool _step(links*& parent, std::uint64_t& version, links* const child) noexcept {
+        const auto child_version = child->version.load(std::memory_order_acquire);
+        if((child_version & 1) || parent->version.load(std::memory_order_relaxed) != version)
+            return false;
+        parent = child;
+        version = child_version;
+        return true;
+    }
+    /**
+     * @brief Helper function implementing the optimistic descent. Every child pointer is read between
+     * two reads of the version of its node: if they differ, or the node is being changed, the descent
+     * gives up. Since a node with an even version is linked, every link followed belonged to the tree
+     * when it was read, and since the node is checked again after reading the version of the child (see
+     * _step()), the subtree of the child still held the key then, in spite of the rotations.
+     *
+     * @tparam K Type comparable with the key type.
+     * @param key Key to be searched.
+     * @param where Where the key is, or where it would be linked.
+     * @param path If not null, filled with the links visited, from the sentinel to the node with the key.
+     * @return bool false if the descent conflicted with a writer and must be restarted.
+     */
+    template <typename K> bool _descend(const K& key, location& where, std::vector<links*>* const path = nullptr) const {
+        if(path)
+            path->clear();
+        links* parent = &_head;
+        bool right = false;
+        auto version = parent->version.load(std::memory_order_acquire);
+        if(version & 1)
+            return false;
+        while(true){
+            const auto _node = _child(parent, right).load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(parent->version.load(std::memory_order_relaxed) != version)
+                return false;
+            if(path)
+                path->push_back(parent);
+            if(!_node || (!f(key, _node->pair.first) && !f(_node->pair.first, key))){
+                if(path && _node)
+                    path->push_back(_node);
+                where = location{_node, parent, right, version};
+                return true;
+            }
+            right = f(_node->pair.first, key);
+            if(!_step(parent, version, _node))
+                return false;
+        }
+    }
+    /**
+     * @brief Helper function returning where a key is, restarting the descent until it succeeds.
+     */
+    template <typename K> location _locate(const K& key) const noexcept {
+        location where;
+        while(!_descend(key, where)){}
+        return where;
+    }
+    /**
+     * @brief Helper function returning the height of a (possibly empty) subtree.
+     */
+    static int _height(const links* const n) noexcept { return n ? n->height.load(std::memory_order_relaxed) : 0; }
+    /**
+     * @brief Helper function to rotate the subtree rooted at a node towards its lighter side, with a
+     * single or a double rotation. The caller holds the locks of the node and of its parent; the
+     * locks of the children involved are taken here, top-down.
+     *
+     * @param parent Parent of the node, locked.
+     * @param side true if the node is the right child of parent.
+     * @param n Node, locked, whose subtrees differ in height by more than one.
+     * @param heavy true if the right subtree of n is the taller one.
+     */
+    static void _rotate(links* const parent, const bool side, node* const n, const bool heavy) noexcept {
+        const auto y = _child(n, heavy).load(std::memory_order_relaxed);
+        std::lock_guard<std::mutex> y_guard{y->lock};
+        const auto outer = _child(y, heavy).load(std::memory_order_relaxed);
+        const auto inner = _child(y, !heavy).load(std::memory_order_relaxed);
+        const auto n_light = _child(n, !heavy).load(std::memory_order_relaxed);
+        if(_height(inner) <= _height(outer)){
+            // single rotation: y takes the place of n, which adopts the inner subtree of y.
+            _begin_write(parent);
+            _begin_write(n);
+            _begin_write(y);
+            _child(n, heavy).store(inner, std::memory_order_release);
+            n->height.store(1 + std::max(_height(inner), _height(n_light)), std::memory_order_relaxed);
+            _child(y, !heavy).store(n, std::memory_order_release);
+            y->height.store(1 + std::max(_height(outer), _height(n)), std::memory_order_relaxed);
+            _child(parent, side).store(y, std::memory_order_release);
+            _end_write(y);
+            _end_write(n);
+            _end_write(parent);
+            return;
+        }
+        // double rotation: the inner child z of y takes the place of n, with y and n as children.
+        const auto z = inner;
+        std::lock_guard<std::mutex> z_guard{z->lock};
+        const auto z_heavy = _child(z, heavy).load(std::memory_order_relaxed);
+        const auto z_light = _child(z, !heavy).load(std::memory_order_relaxed);
+        _begin_write(parent);
+        _begin_write(n);
+        _begin_write(y);
+        _begin_write(z);
+        _child(y, !heavy).store(z_heavy, std::memory_order_release);
+        y->height.store(1 + std::max(_height(outer), _height(z_heavy)), std::memory_order_relaxed);
+        _child(n, heavy).store(z_light, std::memory_order_release);
+        n->height.store(1 + std::max(_height(n_light), _height(z_light)), std::memory_order_relaxed);
+        _child(z, heavy).store(y, std::memory_order_release);
+        _child(z, !heavy).store(n, std::memory_order_release);
+        z->height.store(1 + std::max(_height(y), _height(n)), std::memory_order_relaxed);
+        _child(parent, side).store(z, std::memory_order_release);
+        _end_write(z);
+        _end_write(y);
+        _end_write(n);
+        _end_write(parent);
+    }
+    /**
+     * @brief Helper function to restore the heights and the balance from a node whose subtree has
+     * changed up to the root, along the path to its key. Every step locks a node and its parent, checks
+     * that they are still linked together, then updates the height of the node or rotates it. The walk
+     * stops at the first node whose height does not change, or whose links have been changed by
+     * another writer meanwhile (relaxed balancing).
+     *
+     * @param changed Links whose subtree has changed (nothing is done for the sentinel).
+     */
+    void _rebalance(links* const changed){
+        if(changed == &_head)
+            return;
+        const auto& key = static_cast<node*>(changed)->pair.first;
+        std::vector<links*> path;
+        location where;
+        while(!_descend(key, where, &path)){}
+        // path runs from the sentinel to the node with the key, which may be a copy of changed.
+        if(!where._node)
+            return;
+        for(auto i = path.size() - 1; i > 0; --i){
+            const auto parent = path[i - 1];
+            const auto n = static_cast<node*>(path[i]);
+            std::lock_guard<std::mutex> parent_guard{parent->lock};
+            // parent is locked, so an odd version means that it has been unlinked.
+            if(parent->version.load(std::memory_order_relaxed) & 1)
+                return;
+            const bool side = parent->right.load(std::memory_order_relaxed) == n;
+            if(!side && parent->left.load(std::memory_order_relaxed) != n)
+                return;
+            std::lock_guard<std::mutex> node_guard{n->lock};
+            const auto left = _height(n->left.load(std::memory_order_relaxed));
+            const auto right = _height(n->right.load(std::memory_order_relaxed));
+            if(left > right + 1 || right > left + 1){
+                _rotate(parent, side, n, right > left);
+                continue;
+            }
+            const auto height = 1 + std::max(left, right);
+            if(height == n->height.load(std::memory_order_relaxed))
+                return;
+            n->height.store(height, std::memory_order_relaxed);
+        }
+    }
+    /**
+     * @brief Helper function implementing the optimistic descent to the first node whose key is greater
+     * than a given key, validated like _descend().
+     *
+     * @param key Pointer to the key, nullptr to find the first node of the tree.
+     * @param next Pointer to the node found, nullptr if there is none.
+     * @return bool false if the descent conflicted with a writer and must be restarted.
+     */
+    bool _descend_next(const KT* const key, node*& next) const noexcept {
+        links* parent = &_head;
+        bool right = false;
+        node* candidate = nullptr;
+        auto version = parent->version.load(std::memory_order_acquire);
+        if(version & 1)
+            return false;
+        while(true){
+            const auto _node = _child(parent, right).load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(parent->version.load(std::memory_order_relaxed) != version)
+                return false;
+            if(!_node){
+                next = candidate;
+                return true;
+            }
+            right = key && !f(*key, _node->pair.first);
+            if(!right)
+                candidate = _node;
+            if(!_step(parent, version, _node))
+                return false;
+        }
+    }
+
+    /**
+     * @brief Helper function to insert a pair, if its key is not present.
+     *
+     * @tparam OT
+     * @param pair Pair to be inserted.
+     * @return bool true if a new node has been linked, false if the key was already present.
+     */
+    template <typename OT> bool _insert(OT&& pair){
+        node* fresh = nullptr;
+        while(true){
+            // once the pair has been moved into the new node, the key is read from there.
+            const auto where = _locate(fresh ? fresh->pair.first : pair.first);
+            if(where._node){
+                delete fresh;
+                return false;
+            }
+            std::unique_lock<std::mutex> guard{where.parent->lock};
+            // the version also changes if the parent has been unlinked.
+            if(where.parent->version.load(std::memory_order_relaxed) != where.version)
+                continue;
+            if(!fresh){
+                fresh = new node{std::forward<OT>(pair)};
+            }
+            _begin_write(where.parent);
+            _child(where.parent, where.right).store(fresh, std::memory_order_release);
+            _end_write(where.parent);
+            ++_size;
+            guard.unlock();
+            _rebalance(where.parent);
+            return true;
+        }
+    }
+    /**
+     * @brief Helper function to erase a key.
+     *
+     * @tparam K Type comparable with the key type.
+     * @param key Key to be erased.
+     * @return bool true if the key has been erased, false if it was not present.
+     */
+    template <typename K> bool _erase(const K& key){
+        while(true){
+            const auto where = _locate(key);
+            if(!where._node)
+                return false;
+            const auto parent = where.parent;
+            const auto _node = where._node;
+            std::unique_lock<std::mutex> parent_guard{parent->lock};
+            if(parent->version.load(std::memory_order_relaxed) != where.version)
+                continue;
+            // _node is still linked below parent, and cannot be unlinked by anybody else while we hold
+            // the lock of parent.
+            std::unique_lock<std::mutex> node_guard{_node->lock};
+            const auto left = _node->left.load(std::memory_order_relaxed);
+            const auto right = _node->right.load(std::memory_order_relaxed);
+            if(!left || !right){
+                _begin_write(parent);
+                _child(parent, where.right).store(left ? left : right, std::memory_order_release);
+                _end_write(parent);
+                _mark_unlinked(_node);
+                node_guard.unlock();
+                parent_guard.unlock();
+                _domain.retire(_node);
+                --_size;
+                _rebalance(parent);
+                return true;
+            }
+            // find the successor, locking hand over hand down the left spine of the right subtree.
+            // successor_parent stays locked, as well as the successor.
+            links* successor_parent = _node;
+            std::unique_lock<std::mutex> successor_parent_guard;
+            auto successor = right;
+            std::unique_lock<std::mutex> successor_guard{successor->lock};
+            while(const auto next = successor->left.load(std::memory_order_relaxed)){
+                std::unique_lock<std::mutex> next_guard{next->lock};
+                successor_parent_guard = std::move(successor_guard);
+                successor_guard = std::move(next_guard);
+                successor_parent = successor;
+                successor = next;
+            }
+            const auto successor_right = successor->right.load(std::memory_order_relaxed);
+            // the copy of the successor takes the place of _node. It is linked before the successor is
+            // spliced out, so that its key is always reachable.
+            auto copy = new node{successor->pair};
+            copy->height.store(_node->height.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            copy->left.store(left, std::memory_order_relaxed);
+            copy->right.store(successor_parent == _node ? successor_right : right, std::memory_order_relaxed);
+            _begin_write(parent);
+            _child(parent, where.right).store(copy, std::memory_order_release);
+            _end_write(parent);
+            if(successor_parent != _node){
+                _begin_write(successor_parent);
+                successor_parent->left.store(successor_right, std::memory_order_release);
+                _end_write(successor_parent);
+            }
+            _mark_unlinked(_node);
+            _mark_unlinked(successor);
+            successor_guard.unlock();
+            successor_parent_guard = std::unique_lock<std::mutex>{};
+            node_guard.unlock();
+            parent_guard.unlock();
+            _domain.retire(_node);
+            _domain.retire(successor);
+            --_size;
+            // the subtree which lost the successor: the right one of the copy, or the one below successor_parent.
+            _rebalance(successor_parent == _node ? copy : successor_parent);
+            return true;
+        }
+    }
+    /**
+     * @brief Helper function to free all the nodes of a subtree, iteratively.
+     */
+    static void _destroy_subtree(node* const root) noexcept {
+        std::vector<node*> stack;
+        if(root)
+            stack.push_back(root);
+        while(!stack.empty()){
+            auto _node = stack.back();
+            stack.pop_back();
+            if(auto left = _node->left.load(std::memory_order_relaxed))
+                stack.push_back(left);
+            if(auto right = _node->right.load(std::memory_order_relaxed))
+                stack.push_back(right);
+            delete _node;
+        }
+    }
+
+    public:
+
+    /**
+     * @brief Construct an empty tree.
+     *
+     * @param f Comparison operator.
+     */
+    explicit concurrent_BST(F f = F{}): f{f} {}
+
+    concurrent_BST(const concurrent_BST&) = delete;
+    concurrent_BST& operator=(const concurrent_BST&) = delete;
+
+    /**
+     * @brief Destroy the tree, freeing the linked and the retired nodes. No other thread may be using it.
+     */
+    ~concurrent_BST() noexcept {
+        _destroy_subtree(_head.left.load(std::memory_order_relaxed));
+    }
+
+    /**
+     * @brief Insert a pair, if its key is not present. Thread-safe.
+     *
+     * @param pair Pair to be inserted.
+     * @return bool true if a new node has been linked, false if the key was already present.
+     */
+    bool insert(const PairType& pair) {
+        const auto guard = _domain.pin();
+        return _insert(pair);
+    }
+    bool insert(PairType&& pair) {
+        const auto guard = _domain.pin();
+        return _insert(std::move(pair));
+    }
+    /**
+     * @brief Emplace a pair, if its key is not present. Thread-safe.
+     *
+     * @tparam Types
+     * @param args arguments to be packed.
+     * @return bool true if a new node has been linked, false if the key was already present.
+     */
+    template <typename ... Types>
+    bool emplace(Types&& ... args) { return insert(PairType{std::forward<Types>(args)...}); }
+
+    /**
+     * @brief Erase a key. Thread-safe.
+     *
+     * @param key Key to be erased.
+     * @return bool true if the key has been erased, false if it was not present.
+     */
+    bool erase(const KT& key) {
+        const auto guard = _domain.pin();
+        return _erase(key);
+    }
+
+    /**
+     * @brief Finds a given key without taking any lock. Thread-safe.
+     *
+     * @param key Key to be found.
+     * @return std::optional<VT> A copy of the value mapped to the key, if present.
+     */
+    std::optional<VT> find(const KT& key) const {
+        const auto guard = _domain.pin();
+        const auto where = _locate(key);
+        if(!where._node)
+            return std::nullopt;
+        return where._node->pair.second;
+    }
+    /**
+     * @brief Returns the number of nodes with the given key, i.e., 1 if the key is present and 0 otherwise.
+     * Thread-safe, lock-free.
+     *
+     * @param key
+     * @return std::size_t
+     */
+    std::size_t count(const KT& key) const noexcept { return contains(key) ? 1 : 0; }
+    /**
+     * @brief Returns true if the key is present, false otherwise. Thread-safe, lock-free.
+     *
+     * @param key
+     * @return bool
+     */
+    bool contains(const KT& key) const noexcept {
+        const auto guard = _domain.pin();
+        return _locate(key)._node != nullptr;
+    }
+
+    /**
+     * @brief Call a function on every pair, in ascending order of key, without taking any lock.
+     * Thread-safe. Each step is a validated descent to the next key, so a key present during the whole
+     * visit is visited exactly once, keys inserted or erased meanwhile may or may not be, and the
+     * keys are always visited in strictly ascending order. The nodes retired during the visit are
+     * not freed before it ends.
+     *
+     * @tparam Function Callable with a const reference to a pair.
+     * @param function Function to be called.
+     */
+    template <typename Function> void for_each(Function function) const {
+        const auto guard = _domain.pin();
+        const KT* key = nullptr;
+        while(true){
+            node* next;
+            while(!_descend_next(key, next)){}
+            if(!next)
+                return;
+            function(static_cast<const PairType&>(next->pair));
+            key = &next->pair.first;
+        }
+    }
+
+    /**
+     * @brief Returns the height of the tree (the number of nodes of its longest path from the root), 0 if
+     * it is empty, walking it in O(n). Exact only if no writer is running.
+     *
+     * @return std::size_t
+     */
+    std::size_t height() const {
+        const auto guard = _domain.pin();
+        std::vector<std::pair<const node*, std::size_t>> stack;
+        std::size_t result = 0;
+        if(const auto root = _head.left.load(std::memory_order_acquire))
+            stack.emplace_back(root, 1);
+        while(!stack.empty()){
+            const auto [n, depth] = stack.back();
+            stack.pop_back();
+            result = std::max(result, depth);
+            if(const auto left = n->left.load(std::memory_order_acquire))
+                stack.emplace_back(left, depth + 1);
+            if(const auto right = n->right.load(std::memory_order_acquire))
+                stack.emplace_back(right, depth + 1);
+        }
+        return result;
+    }
+
+    /**
+     * @brief Returns the number of keys. Exact only if no writer is running.
+     *
+     * @return std::size_t
+     */
+    std::size_t size() const noexcept { return _size.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Free the nodes unlinked by erase() which no running operation can be visiting anymore.
+     * Can be called at any time; erase() calls it periodically as well.
+     *
+     * @return std::size_t Number of nodes freed.
+     */
+    std::size_t reclaim() noexcept { return _domain.collect(); }
+
+    /**
+     * @brief Overload of operator put-to. Same format as the one of BST.
+     *
+     * @param os Reference to std::ostream.
+     * @param tree Const reference to the tree.
+     * @return std::ostream&
+     */
+    friend std::ostream &operator<<(std::ostream &os, const concurrent_BST &tree){
+        if(!tree.size()){
+            os << "BST is empty => size: [0] \n";
+            return os;
+        }
+        os << "size: [" << tree.size() << "] ";
+        tree.for_each([&os](const PairType& pair){ os << pair.first << " "; });
+        os << "\n";
+        return os;
+    }
+};
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef epoch_h
+#define epoch_h
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Epoch-based reclamation of the objects of type T which are unlinked from a shared data
+ * structure while readers may still be visiting them.
+ *
+ * Every operation on the structure pins the current epoch for its whole duration, announcing it in
+ * one of a fixed number of slots (each on its own cache line, so that readers do not share any
+ * written memory). An unlinked object is retired together with the epoch at that moment. The epoch
+ * advances only once every pinned operation has announced it, hence an object retired in epoch e
+ * can no longer be reached by anybody once the epoch is e+2, and it is deleted then.
+ *
+ * @tparam T Type of the retired objects, deleted with delete.
+ */
+template<typename T>
+class epoch_domain{
+    // maximum number of operations pinned at once. Further operations wait for a free slot.
+    static constexpr std::size_t _slot_count = 64;
+    // number of retired objects after which retire() tries to reclaim memory.
+    static constexpr std::size_t _collect_threshold = 64;
+
+    /**
+     * @brief Announcement of a pinned operation: 0 if the slot is free, 2e+1 if the operation
+     * runs in epoch e.
+     */
+    struct alignas(64) slot{
+        std::atomic<std::uint64_t> state{0};
+    };
+
+    std::array<slot, _slot_count> slots;
+    alignas(64) std::atomic<std::uint64_t> epoch{0};
+    // retired objects with their epoch, in non-decreasing order of epoch.
+    std::vector<std::pair<T*, std::uint64_t>> retired;
+    std::mutex retired_lock;
+
+    /**
+     * @brief Helper function to advance the epoch, if every pinned operation runs in the current one.
+     * Must be called holding retired_lock.
+     */
+    void _try_advance() noexcept {
+        auto current = epoch.load(std::memory_order_seq_cst);
+        for(const auto& s: slots){
+            const auto state = s.state.load(std::memory_order_seq_cst);
+            if(state && state != 2*current + 1)
+                return;
+        }
+        epoch.compare_exchange_strong(current, current + 1, std::memory_order_seq_cst);
+    }
+
+    public:
+
+    /**
+     * @brief RAII object keeping an operation pinned to its epoch. The objects retired from then on
+     * are not deleted until it is destroyed.
+     */
+    class guard{
+        slot& s;
+
+        public:
+        explicit guard(slot& s) noexcept: s{s} {}
+        guard(const guard&) = delete;
+        guard& operator=(const guard&) = delete;
+        ~guard() noexcept { s.state.store(0, std::memory_order_release); }
+    };
+
+    epoch_domain() = default;
+    epoch_domain(const epoch_domain&) = delete;
+    epoch_domain& operator=(const epoch_domain&) = delete;
+
+    /**
+     * @brief Destroy the domain, deleting all the retired objects. No operation may be pinned.
+     */
+    ~epoch_domain() noexcept {
+        for(auto& object: retired)
+            delete object.first;
+    }
+
+    /**
+     * @brief Pin the calling operation to the current epoch. Lock-free as long as fewer than 64
+     * operations are pinned at once.
+     *
+     * @return guard Unpins the operation when destroyed.
+     */
+    guard pin() noexcept {
+        auto index = std::hash<std::thread::id>{}(std::this_thread::get_id());
+        while(true){
+            auto& s = slots[index++ % _slot_count];
+            auto current = epoch.load(std::memory_order_seq_cst);
+            std::uint64_t expected = 0;
+            if(s.state.load(std::memory_order_relaxed) == 0 &&
+               s.state.compare_exchange_strong(expected, 2*current + 1, std::memory_order_seq_cst)){
+                // the epoch may have advanced before the announcement was visible: announce again
+                // until it is stable.
+                for(auto now = epoch.load(std::memory_order_seq_cst); now != current; now = epoch.load(std::memory_order_seq_cst)){
+                    current = now;
+                    s.state.store(2*current + 1, std::memory_order_seq_cst);
+                }
+                return guard{s};
+            }
+        }
+    }
+
+    /**
+     * @brief Retire an object, which must already be unreachable for the operations starting from
+     * now on. It is deleted once no pinned operation can be visiting it.
+     *
+     * @param object Pointer to the object.
+     */
+    void retire(T* const object){
+        std::size_t pending;
+        {
+            std::lock_guard<std::mutex> lock{retired_lock};
+            retired.emplace_back(object, epoch.load(std::memory_order_seq_cst));
+            pending = retired.size();
+        }
+        if(pending % _collect_threshold == 0)
+            collect();
+    }
+
+    /**
+     * @brief Advance the epoch if possible and delete the retired objects which can no longer be reached.
+     * Can be called at any time.
+     *
+     * @return std::size_t Number of objects deleted.
+     */
+    std::size_t collect() noexcept {
+        std::lock_guard<std::mutex> lock{retired_lock};
+        // two advances make the objects retired in the current epoch expire, if nobody is pinned.
+        _try_advance();
+        _try_advance();
+        const auto current = epoch.load(std::memory_order_seq_cst);
+        auto last = retired.begin();
+        for(; last != retired.end() && last->second + 2 <= current; ++last)
+            delete last->first;
+        const auto freed = static_cast<std::size_t>(last - retired.begin());
+        retired.erase(retired.begin(), last);
+        return freed;
+    }
+};
+
+#endif
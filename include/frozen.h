@@ -0,0 +1,447 @@
+#ifndef frozen_h
+#define frozen_h
+
+#include <iostream>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "iterator.h"
+#include "BST.h"
+#include "simd.h"
+
+/**
+ * @brief Layouts of the keys of a frozen_BST.
+ *
+ * A layout stores a copy of the keys of the snapshot arranged for fast searching, and provides:
+ * - `build(pairs)`, which fills the layout from the vector of the pairs of the snapshot, sorted by key;
+ * - `lower_bound(key, f)` and `upper_bound(key, f)`, which return the position in that vector of the
+ *   first pair whose key is not less than (greater than) key, or its size if there is none.
+ */
+
+/**
+ * @brief Eytzinger layout: the keys are stored in the breadth-first order of a perfectly balanced
+ * tree, i.e., the children of the key at position k, counting from 1, are at 2k and 2k+1.
+ * A lookup walks the array from the front, so the first levels of the tree share a handful of
+ * cache lines, and no pointer is ever followed: the next position is computed from the current one,
+ * which lets the processor prefetch the keys of the following levels. Works with any key type and
+ * comparison operator.
+ *
+ * @tparam KT Key type.
+ */
+template<typename KT>
+class eytzinger_layout{
+    // keys[k-1] is the key at position k of the implicit tree.
+    std::vector<KT> keys;
+    // ranks[k-1] is the position in the sorted vector of pairs of keys[k-1].
+    std::vector<std::size_t> ranks;
+
+    // number of keys per cache line. The descendants of position k four levels below (for 4-byte
+    // keys) are the 16 keys from position 16k: prefetching them hides the latency of the next levels.
+    static constexpr std::size_t _stride = sizeof(KT) < 64 ? 64 / sizeof(KT) : 1;
+
+    /**
+     * @brief Helper function to fill keys and ranks visiting the implicit tree in order.
+     *
+     * @param pairs Pairs sorted by key.
+     * @param k Position of the root of the subtree, counting from 1.
+     * @param rank Reference to the rank of the next key in order.
+     */
+    template <typename P> void _fill(const std::vector<P>& pairs, const std::size_t k, std::size_t& rank){
+        if(k > pairs.size()){
+            return;
+        }
+        _fill(pairs, 2*k, rank);
+        keys[k-1] = pairs[rank].first;
+        ranks[k-1] = rank++;
+        _fill(pairs, 2*k + 1, rank);
+    }
+    /**
+     * @brief Helper function to hint the processor that the keys a few levels below position k
+     * will be needed soon. Does nothing if the compiler has no prefetch builtin.
+     */
+    void _prefetch(const std::size_t k) const noexcept {
+#if defined(__GNUC__)
+        __builtin_prefetch(keys.data() + _stride * k);
+#else
+        (void)k;
+#endif
+    }
+    /**
+     * @brief Helper function to turn the position where a descent fell off the implicit tree into
+     * the position of the last key from which the descent went left, i.e., the answer of the search.
+     * Going left appends a 0 to the binary representation of the position and going right a 1, so
+     * the trailing ones are dropped together with the last 0.
+     *
+     * @param k Position reached by the descent.
+     * @return std::size_t Rank of the key found, the number of keys if the descent never went left.
+     */
+    std::size_t _result(std::size_t k) const noexcept {
+        while(k & 1){
+            k >>= 1;
+        }
+        k >>= 1;
+        return k ? ranks[k-1] : keys.size();
+    }
+
+    public:
+
+    template <typename P> void build(const std::vector<P>& pairs){
+        keys.clear();
+        ranks.clear();
+        if(pairs.empty()){
+            return;
+        }
+        keys.assign(pairs.size(), pairs.front().first);
+        ranks.assign(pairs.size(), 0);
+        std::size_t rank = 0;
+        _fill(pairs, 1, rank);
+    }
+
+    template <typename K, typename F> std::size_t lower_bound(const K& key, const F& f) const noexcept {
+        const auto n = keys.size();
+        std::size_t k = 1;
+        while(k <= n){
+            _prefetch(k);
+            k = 2*k + f(keys[k-1], key);
+        }
+        return _result(k);
+    }
+
+    template <typename K, typename F> std::size_t upper_bound(const K& key, const F& f) const noexcept {
+        const auto n = keys.size();
+        std::size_t k = 1;
+        while(k <= n){
+            _prefetch(k);
+            k = 2*k + !f(key, keys[k-1]);
+        }
+        return _result(k);
+    }
+};
+
+/**
+ * @brief Blocked layout for arithmetic keys ordered by std::less: a static B-tree whose nodes are
+ * blocks of B sorted keys filling a cache line (B = 16 for 4-byte keys, 8 for 8-byte keys), stored
+ * in breadth-first order, i.e., the children of block k are the blocks k(B+1)+1 ... k(B+1)+B+1.
+ * Within a block the child to descend into is the number of keys less than the searched one, which
+ * is computed with SIMD comparisons of the whole block (see simd.h), so that a lookup costs about
+ * one cache line per level and there are log_(B+1)(n) levels instead of log2(n).
+ * The last blocks are padded with the greatest value of the key type, which is never counted as
+ * less than a key, so padding only ever follows the real keys.
+ *
+ * @tparam KT Arithmetic key type.
+ */
+template<typename KT>
+class simd_block_layout{
+    static_assert(std::is_arithmetic<KT>::value, "The blocked layout requires arithmetic keys.");
+
+    static constexpr std::size_t B = _block_size<KT>;
+    using search = _block_search<KT>;
+
+    // blocks of B keys, each aligned to a cache line.
+    std::vector<KT, _cache_aligned_allocator<KT>> keys;
+    // ranks[i] is the position in the sorted vector of pairs of keys[i], the number of pairs for padding.
+    std::vector<std::size_t> ranks;
+    // number of keys (padding excluded) and of blocks.
+    std::size_t size{0};
+    std::size_t blocks{0};
+
+    /**
+     * @brief Index of the i-th child (from 0 to B) of block k.
+     */
+    static std::size_t _child(const std::size_t k, const std::size_t i) noexcept { return k*(B + 1) + i + 1; }
+
+    /**
+     * @brief Helper function to fill keys and ranks visiting the blocks in order.
+     *
+     * @param pairs Pairs sorted by key.
+     * @param k Index of the block at the root of the subtree.
+     * @param rank Reference to the rank of the next key in order.
+     */
+    template <typename P> void _fill(const std::vector<P>& pairs, const std::size_t k, std::size_t& rank){
+        if(k >= blocks){
+            return;
+        }
+        constexpr auto padding = std::numeric_limits<KT>::has_infinity ? std::numeric_limits<KT>::infinity()
+                                                                        : std::numeric_limits<KT>::max();
+        for(std::size_t i = 0; i < B; ++i){
+            _fill(pairs, _child(k, i), rank);
+            const auto slot = k*B + i;
+            if(rank < size){
+                keys[slot] = pairs[rank].first;
+                ranks[slot] = rank++;
+            }
+            else{
+                keys[slot] = padding;
+                ranks[slot] = size;
+            }
+        }
+        _fill(pairs, _child(k, B), rank);
+    }
+
+    public:
+
+    template <typename P> void build(const std::vector<P>& pairs){
+        size = pairs.size();
+        blocks = (size + B - 1) / B;
+        keys.assign(blocks * B, KT{});
+        ranks.assign(blocks * B, 0);
+        std::size_t rank = 0;
+        _fill(pairs, 0, rank);
+    }
+
+    template <typename F> std::size_t lower_bound(const KT key, const F&) const noexcept {
+        // slot of the smallest key not less than key met so far.
+        auto found = keys.size();
+        for(std::size_t k = 0; k < blocks; ){
+            const auto i = search::count_less(keys.data() + k*B, key);
+            if(i < B)
+                found = k*B + i;
+            k = _child(k, i);
+        }
+        return found < keys.size() ? ranks[found] : size;
+    }
+
+    template <typename F> std::size_t upper_bound(const KT key, const F&) const noexcept {
+        auto found = keys.size();
+        for(std::size_t k = 0; k < blocks; ){
+            const auto i = B - search::count_greater(keys.data() + k*B, key);
+            if(i < B)
+                found = k*B + i;
+            k = _child(k, i);
+        }
+        return found < keys.size() ? ranks[found] : size;
+    }
+};
+
+/**
+ * @brief Layout picked by default by frozen_BST: simd_block_layout for arithmetic keys ordered by
+ * std::less, eytzinger_layout otherwise.
+ */
+template<typename KT, typename F>
+using _default_layout = std::conditional_t<std::is_arithmetic<KT>::value &&
+                                           (std::is_same<F, std::less<const KT>>::value || std::is_same<F, std::less<KT>>::value),
+                                           simd_block_layout<KT>, eytzinger_layout<KT>>;
+
+/**
+ * @brief Read-only snapshot of a BST, laid out for cache-friendly lookups.
+ *
+ * The pairs are stored in a single array sorted by key, so that iterating is a linear scan, while
+ * the keys are copied into a layout optimized for searching (see eytzinger_layout and
+ * simd_block_layout above). A lookup searches the layout and never follows a pointer.
+ *
+ * The snapshot has the same read-only interface as BST (find, count, contains, the bounds, range,
+ * iterators and put-to operator). It is not updated when the tree it was taken from changes.
+ *
+ * @tparam KT Key type.
+ * @tparam VT Value type.
+ * @tparam F Type of comparison operator. Default: std::less<const KT>.
+ * @tparam Layout Layout of the keys. Default: simd_block_layout<KT> if KT is arithmetic and F is
+ * std::less, eytzinger_layout<KT> otherwise.
+ */
+template<typename KT, typename VT, typename F = std::less<const KT>, typename Layout = _default_layout<KT, F>>
+class frozen_BST{
+    using PairType = std::pair<const KT, VT>; // Pair Type
+    using const_iterator = const PairType*;
+    using iterator = const_iterator;
+
+    F f;
+    // pairs in ascending order of key.
+    std::vector<PairType> pairs;
+    // keys arranged for searching.
+    Layout layout;
+
+    /**
+     * @brief Helper function returning the first pair whose key is not less than key.
+     *
+     * @tparam K Type comparable with the key type.
+     * @param key Key to be searched.
+     */
+    template <typename K> const_iterator _lower_bound(const K& key) const noexcept {
+        return pairs.data() + layout.lower_bound(key, f);
+    }
+    /**
+     * @brief Helper function returning the first pair whose key is greater than key.
+     *
+     * @tparam K Type comparable with the key type.
+     * @param key Key to be searched.
+     */
+    template <typename K> const_iterator _upper_bound(const K& key) const noexcept {
+        return pairs.data() + layout.upper_bound(key, f);
+    }
+    /**
+     * @brief Helper function returning the pair with the given key, nullptr if it is not present.
+     *
+     * @tparam K Type comparable with the key type.
+     * @param key Key to be searched.
+     */
+    template <typename K> const_iterator _find(const K& key) const noexcept {
+        auto it = _lower_bound(key);
+        return (it != end() && !f(key, it->first)) ? it : nullptr;
+    }
+
+    public:
+
+    /**
+     * @brief Construct an empty snapshot.
+     *
+     */
+    frozen_BST() = default;
+
+    /**
+     * @brief Take a snapshot of a BST in O(n).
+     *
+     * @tparam Policies Policies of the BST (balancing, allocator, diagnostics, augmentation).
+     * @param tree Tree to be copied.
+     * @param f Comparison operator, which must order the keys like the one of the tree.
+     */
+    template <typename ... Policies>
+    explicit frozen_BST(const BST<KT, VT, F, Policies...>& tree, F f = F{}): f{f} {
+        for(const auto& pair: tree)
+            pairs.push_back(pair);
+        layout.build(pairs);
+    }
+
+    /**
+     * @brief Returns the number of pairs of the snapshot.
+     *
+     * @return std::size_t
+     */
+    std::size_t size() const noexcept { return pairs.size(); }
+
+    /**
+     * @brief Finds a given key. If the key is present, returns an iterator to the proper pair,
+     * end() otherwise.
+     *
+     * @param key Key to be found.
+     * @return const_iterator
+     */
+    const_iterator find(const KT& key) const noexcept {
+        auto it = _find(key);
+        return it ? it : end();
+    }
+    /**
+     * @brief Heterogeneous version of find(). Enabled only if F is transparent.
+     *
+     * @tparam K Type comparable with the key type.
+     * @param key Key to be found.
+     * @return const_iterator
+     */
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    const_iterator find(const K& key) const noexcept {
+        auto it = _find(key);
+        return it ? it : end();
+    }
+    /**
+     * @brief Returns the number of pairs with the given key, i.e., 1 if the key is present and 0 otherwise.
+     *
+     * @param key
+     * @return std::size_t
+     */
+    std::size_t count(const KT& key) const noexcept { return _find(key) ? 1 : 0; }
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    std::size_t count(const K& key) const noexcept { return _find(key) ? 1 : 0; }
+    /**
+     * @brief Returns true if the key is present in the snapshot, false otherwise.
+     *
+     * @param key
+     * @return bool
+     */
+    bool contains(const KT& key) const noexcept { return _find(key) != nullptr; }
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    bool contains(const K& key) const noexcept { return _find(key) != nullptr; }
+
+    /**
+     * @brief Returns an iterator to the first pair whose key is not less than key, end() if there is none.
+     *
+     * @param key
+     * @return const_iterator
+     */
+    const_iterator lower_bound(const KT& key) const noexcept { return _lower_bound(key); }
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    const_iterator lower_bound(const K& key) const noexcept { return _lower_bound(key); }
+    /**
+     * @brief Returns an iterator to the first pair whose key is greater than key, end() if there is none.
+     *
+     * @param key
+     * @return const_iterator
+     */
+    const_iterator upper_bound(const KT& key) const noexcept { return _upper_bound(key); }
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    const_iterator upper_bound(const K& key) const noexcept { return _upper_bound(key); }
+    /**
+     * @brief Returns the range of pairs with the given key, i.e., lower_bound() and upper_bound().
+     *
+     * @param key
+     * @return std::pair<const_iterator, const_iterator>
+     */
+    auto equal_range(const KT& key) const noexcept { return std::make_pair(_lower_bound(key), _upper_bound(key)); }
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    auto equal_range(const K& key) const noexcept { return std::make_pair(_lower_bound(key), _upper_bound(key)); }
+    /**
+     * @brief Returns a lazy view over the pairs with keys in [low, high).
+     *
+     * @param low Smallest key of the range.
+     * @param high Key one-past the range.
+     * @return _iterator_range<const_iterator>
+     */
+    auto range(const KT& low, const KT& high) const noexcept {
+        auto first = _lower_bound(low);
+        auto last = _lower_bound(high);
+        return _iterator_range<const_iterator>{first, first < last ? last : first};
+    }
+
+    /**
+     * @brief Returns iterator to the beginning of the snapshot.
+     *
+     * @return const_iterator
+     */
+    const_iterator begin() const noexcept { return pairs.data(); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    /**
+     * @brief Returns iterator to end of the snapshot.
+     *
+     * @return const_iterator
+     */
+    const_iterator end() const noexcept { return pairs.data() + pairs.size(); }
+    const_iterator cend() const noexcept { return end(); }
+    /**
+     * @brief Returns reverse iterator to the last pair of the snapshot.
+     *
+     * @return std::reverse_iterator<const_iterator>
+     */
+    auto rbegin() const noexcept { return std::reverse_iterator<const_iterator>{end()}; }
+    auto crbegin() const noexcept { return rbegin(); }
+    /**
+     * @brief Returns reverse iterator to one-before the first pair of the snapshot.
+     *
+     * @return std::reverse_iterator<const_iterator>
+     */
+    auto rend() const noexcept { return std::reverse_iterator<const_iterator>{begin()}; }
+    auto crend() const noexcept { return rend(); }
+
+    /**
+     * @brief Overload of operator put-to. Same format as the one of BST.
+     *
+     * @param os Reference to std::ostream.
+     * @param tree Const reference to the snapshot.
+     * @return std::ostream&
+     */
+    friend std::ostream &operator<<(std::ostream &os, const frozen_BST &tree){
+        if(tree.pairs.empty()){
+            os << "BST is empty => size: [0] \n";
+            return os;
+        }
+        os << "size: [" << tree.pairs.size() << "] ";
+        for(const auto& el : tree)
+            os << el.first << " ";
+        os << "\n";
+        return os;
+    }
+};
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef ingest_h
+#define ingest_h
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief K-way merge of ranges sorted by key: the pairs of all the ranges come out in ascending order
+ * of key, pairs with equal keys in the order of their ranges. The ranges are read once, one pair at a
+ * time, so they can be input iterators over streams or files, and the merge takes O(k) memory and
+ * O(log k) comparisons per pair.
+ *
+ * @tparam It Input iterator to pairs.
+ * @tparam F Type of comparison operator.
+ */
+template<typename It, typename F>
+class _kway_merge{
+    std::vector<std::pair<It, It>> ranges;
+    // indices of the non-empty ranges, as a heap whose front is the range with the least next key.
+    std::vector<std::size_t> heap;
+    const F* f;
+
+    /**
+     * @brief Heap order: true if the next pair of range a comes after the one of range b.
+     */
+    bool _after(const std::size_t a, const std::size_t b) const {
+        const auto& x = (*ranges[a].first).first;
+        const auto& y = (*ranges[b].first).first;
+        return (*f)(y, x) || (!(*f)(x, y) && b < a);
+    }
+
+    public:
+
+    /**
+     * @brief Start merging the given ranges.
+     *
+     * @param ranges Pairs of iterators to the first and past the last pair of each range.
+     * @param f Comparison operator, which must outlive the merge.
+     */
+    _kway_merge(std::vector<std::pair<It, It>> ranges, const F& f): ranges{std::move(ranges)}, f{&f} {
+        const auto after = [this](const std::size_t a, const std::size_t b){ return _after(a, b); };
+        for(std::size_t i = 0; i < this->ranges.size(); ++i)
+            if(this->ranges[i].first != this->ranges[i].second)
+                heap.push_back(i);
+        std::make_heap(heap.begin(), heap.end(), after);
+    }
+
+    bool empty() const noexcept { return heap.empty(); }
+    /**
+     * @brief Returns the next pair of the merge.
+     */
+    decltype(auto) front() const { return *ranges[heap.front()].first; }
+    /**
+     * @brief Move on to the pair following front().
+     */
+    void pop(){
+        const auto after = [this](const std::size_t a, const std::size_t b){ return _after(a, b); };
+        std::pop_heap(heap.begin(), heap.end(), after);
+        auto& range = ranges[heap.back()];
+        if(++range.first != range.second)
+            std::push_heap(heap.begin(), heap.end(), after);
+        else
+            heap.pop_back();
+    }
+
+    /**
+     * @brief Input iterator over the pairs of a merge, so that it can feed the sorted range constructor of
+     * the BST. All the iterators over a merge share its position.
+     */
+    class iterator{
+        _kway_merge* merge;
+
+        public:
+        using value_type = typename std::iterator_traits<It>::value_type;
+        using reference = typename std::iterator_traits<It>::reference;
+        using pointer = typename std::iterator_traits<It>::pointer;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::input_iterator_tag;
+
+        explicit iterator(_kway_merge* merge = nullptr) noexcept: merge{merge} {}
+
+        reference operator*() const { return merge->front(); }
+        iterator& operator++(){
+            merge->pop();
+            return *this;
+        }
+
+        friend bool operator==(const iterator& a, const iterator& b) noexcept {
+            return (!a.merge || a.merge->empty()) == (!b.merge || b.merge->empty());
+        }
+        friend bool operator!=(const iterator& a, const iterator& b) noexcept { return !(a == b); }
+    };
+
+    iterator begin() noexcept { return iterator{this}; }
+    iterator end() noexcept { return iterator{}; }
+};
+
+#endif
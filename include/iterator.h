@@ -4,6 +4,17 @@
 #include <iterator>
 #include <memory>
 #include <utility>
+#include <cstddef>
+#include <type_traits>
+
+/**
+ * @brief Type trait telling whether a node stores the size of its subtree (see order_statistics).
+ */
+template<typename T, typename = void>
+struct _has_subtree_size: std::false_type{};
+template<typename T>
+struct _has_subtree_size<T, std::void_t<decltype(std::declval<T&>().subtree_size)>>: std::true_type{};
+
 /**
  * @brief Iterator class templated on Type T and Value Type O.
  * 
@@ -17,20 +28,34 @@ class _iterator{
    * 
    */
   T* current;
+  /**
+   * @brief Pointer to the slot of the tree caching its rightmost node, so that the end
+   * iterator (current == nullptr) can be decremented. The slot is in the heap-allocated
+   * header of the tree, which moves with the nodes: the iterator survives a move of the tree.
+   * 
+   */
+  T* const* last;
 
  public:
   using value_type = O;
   using reference = value_type &;
   using pointer = value_type *;
   using difference_type = std::ptrdiff_t;
-  using iterator_category = std::forward_iterator_tag;
+  using iterator_category = std::bidirectional_iterator_tag;
+
+  /**
+   * @brief Construct a singular iterator, which does not belong to any tree.
+   * 
+   */
+  _iterator() noexcept: current{nullptr}, last{nullptr} {}
 
   /**
    * @brief Construct a new iterator object from a pointer to type T.
    * 
-   * @param ptr Pointer to type T from which we want to create an iterator. 
+   * @param ptr Pointer to type T from which we want to create an iterator. nullptr is the end iterator.
+   * @param last Pointer to the slot of the tree caching its rightmost node.
    */
-  explicit _iterator(T* ptr) noexcept: current{ptr} {}
+  _iterator(T* ptr, T* const* last) noexcept: current{ptr}, last{last} {}
 
   /**
    * @brief Destroy the iterator object
@@ -51,6 +76,14 @@ class _iterator{
    */
   pointer operator->() const noexcept { return &**this; }
 
+  /**
+   * @brief Returns the pointer to the node the iterator points to, nullptr for the end iterator.
+   * Used by the tree, e.g. to extract the node.
+   * 
+   * @return T*
+   */
+  T* get_node() const noexcept { return current; }
+
   // pre-increment
   /**
    * @brief Overload pre increment operator++().
@@ -74,6 +107,57 @@ class _iterator{
      return tmp;
     }
 
+  // pre-decrement
+  /**
+   * @brief Overload pre decrement operator--(). Decrementing the end iterator gives the
+   * last element of the tree.
+   * 
+   * @return _iterator& 
+   */
+  _iterator &operator--() noexcept {
+     current = current ? prev(current) : *last;
+     return *this;
+    }
+
+  // post-decrement
+  /**
+   * @brief Overload post decrement operator--().
+   * 
+   * @return _iterator 
+   */
+  _iterator operator--(int) noexcept {
+     auto tmp = *this;
+     --(*this);
+     return tmp;
+    }
+
+  /**
+   * @brief Advance the iterator by k positions in O(height) instead of O(k). Available only if the
+   * nodes store the size of their subtree (see order_statistics).
+   * 
+   * @param k Number of positions. Must not be negative.
+   * @return _iterator& 
+   */
+  template<typename U = T, typename = std::enable_if_t<_has_subtree_size<U>::value>>
+  _iterator &operator+=(const difference_type k) noexcept {
+     current = advance(current, k);
+     return *this;
+    }
+
+  /**
+   * @brief Returns an iterator k positions after this one, in O(height). Available only if the
+   * nodes store the size of their subtree (see order_statistics).
+   * 
+   * @param k Number of positions. Must not be negative.
+   * @return _iterator 
+   */
+  template<typename U = T, typename = std::enable_if_t<_has_subtree_size<U>::value>>
+  _iterator operator+(const difference_type k) const noexcept {
+     auto tmp = *this;
+     tmp += k;
+     return tmp;
+    }
+
   /**
    * @brief Overload of operator bool(). Returns TRUE if iterator
    * points to something that isn't nullptr. FALSE otherwise.  
@@ -113,7 +197,7 @@ class _iterator{
    * @return std::ostream& 
    */
   friend std::ostream &operator<<(std::ostream &os, const _iterator &x) {
-    os << "[" << x.current << "]"<< std::endl;
+    os << "[" << x.current << "]\n";
     return os;
   }
 
@@ -156,6 +240,112 @@ class _iterator{
     return _node;
   }
 
+  /**
+  * @brief Helper function to find the predecessor of a node. It is called in the implementation
+  * of operator--() and mirrors next(): the predecessor is the rightmost node of the left subtree,
+  * or else the first ancestor for which the node is in its right subtree.
+  * 
+  * @param _node Pointer to node.
+  * @return node* Pointer to the predecessor node, nullptr if the node is the first one.
+  */
+  static T* prev(T* _node) noexcept{
+    if(!_node){
+      return nullptr;
+    }
+    if(_node->left.get()){
+        _node = _node->left.get();
+        while(_node->right){
+            _node = _node -> right.get();
+        }
+    }
+    else{ 
+        while(_node->parent && _node->parent->left.get() == _node){
+            _node = _node->parent;
+            }
+        _node = _node->parent;
+        }
+    return _node;
+  }
+
+  /**
+  * @brief Helper function to find the k-th node (starting from 0) of the subtree rooted at a node,
+  * using the sizes of the subtrees.
+  * 
+  * @param _node Pointer to the root of the subtree.
+  * @param k Position of the node.
+  * @return node* Pointer to the k-th node, nullptr if the subtree has less than k+1 nodes.
+  */
+  static T* select(T* _node, std::size_t k) noexcept{
+    while(_node){
+        const std::size_t left_size = _node->left ? _node->left->subtree_size : 0;
+        if(k < left_size){
+            _node = _node->left.get();
+        }
+        else if(k == left_size){
+            return _node;
+        }
+        else{
+            k -= left_size + 1;
+            _node = _node->right.get();
+        }
+    }
+    return nullptr;
+  }
+
+  /**
+  * @brief Helper function to find the node k positions after a node, in O(height). It is called in
+  * the implementation of operator+=().
+  * If the target is in the right subtree of the node, it is selected there. Otherwise the right subtree
+  * is skipped and we move to the successor of the whole subtree (the first ancestor for which the
+  * node is in its left subtree), and repeat from there.
+  * 
+  * @param _node Pointer to node.
+  * @param k Number of positions.
+  * @return node* Pointer to the node k positions after, nullptr if there are less than k nodes after.
+  */
+  static T* advance(T* _node, difference_type k) noexcept{
+    while(_node && k > 0){
+        const std::size_t right_size = _node->right ? _node->right->subtree_size : 0;
+        if(static_cast<std::size_t>(k) <= right_size){
+            return select(_node->right.get(), k - 1);
+        }
+        k -= right_size + 1;
+        while(_node->parent && _node->parent->right.get() == _node){
+            _node = _node->parent;
+        }
+        _node = _node->parent;
+    }
+    return _node;
+  }
+
+};
+
+/**
+ * @brief Lazy view over the range [first, last) of a BST. It does not copy anything: it just
+ * holds the two iterators, so that it can be used in a range-for loop.
+ * 
+ * @tparam I Type of the iterators.
+ */
+template<typename I>
+class _iterator_range{
+  I first;
+  I last;
+
+ public:
+  /**
+   * @brief Construct a new range object from two iterators.
+   * 
+   * @param first Iterator to the first element of the range.
+   * @param last Iterator to one-past the last element of the range.
+   */
+  _iterator_range(I first, I last) noexcept: first{first}, last{last} {}
+
+  I begin() const noexcept { return first; }
+  I end() const noexcept { return last; }
+  /**
+   * @brief Returns TRUE if the range contains no elements. FALSE otherwise.
+   */
+  bool empty() const noexcept { return first == last; }
 };
 
 #endif
\ No newline at end of file
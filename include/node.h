@@ -3,16 +3,42 @@
 
 #include <utility>
 #include <memory>
-#include <iostream>
+/**
+ * @brief Empty per-node data. Used when the tree does not need to store anything
+ * besides the pair and the links (e.g. an unbalanced BST).
+ */
+struct _no_node_data{};
+
+/**
+ * @brief Per-node data made of the data of several policies (e.g. the balancing policy and the
+ * augmentation policy of the tree), each one stored as a base.
+ */
+template<typename ... Data>
+struct _node_data: Data ...{};
+
+/**
+ * @brief Deleter of the links between nodes. Nodes are allocated and freed by the BST through
+ * its allocator, therefore a link only expresses the ownership of the child and never frees
+ * it by itself.
+ */
+struct _link_deleter{
+    template<typename N> void operator()(N* const) const noexcept {}
+};
+
 /**
  * @brief A templated struct of node which contains a <key,value> pair, a parent, and
  * left and right children. 
  * @tparam KT The key type of the pair contained by the node.
  * @tparam VT The value type of the pair contained by the node.
+ * @tparam ND Extra per-node data required by the policies of the tree (e.g. the height for
+ * AVL trees, the color for red-black trees, or the size of the subtree). Stored as a base to take advantage
+ * of the empty base optimization.
  */
-template<typename KT, typename VT> // template on Key Type of BST and Value Type.
-struct _node{
+template<typename KT, typename VT, typename ND = _no_node_data> // template on Key Type of BST and Value Type.
+struct _node: ND{
 using PT = std::pair<const KT, VT>; //PT - Pair Type.
+using link = std::unique_ptr<_node, _link_deleter>; // owning link to a child.
+using data = ND; // per-node data.
         /**
          * @brief Pair contained by node. Of type std::pair<const Key Type, Value Type>
          * 
@@ -27,40 +53,44 @@ using PT = std::pair<const KT, VT>; //PT - Pair Type.
          * @brief Unique pointer to left child.
          * 
          */
-        std::unique_ptr<_node> left;
+        link left;
         /**
          * @brief Unique pointer to right child.
          * 
          */
-        std::unique_ptr<_node> right;
+        link right;
         /**
          * @brief Construct a new node object from a reference to a pair type. Sets parent to nullptr.
          * 
          * @param elem A reference to a pair type.
          */
-        explicit _node(const PT& elem) noexcept:pair{elem}, parent{nullptr}{std::cout<<"l-value node ctor"<< std::endl;}
+        explicit _node(const PT& elem) noexcept:ND{}, pair{elem}, parent{nullptr}{}
         /**
          * @brief Construct a new node object from an r-value of pair type. Sets parent to nullptr.
          * 
          * @param elem An r-value of pair type.
          */
-        explicit _node(PT&& elem) noexcept: pair{std::move(elem)}, parent{nullptr}{std::cout<<"r-value node ctor"<< std::endl;}
+        explicit _node(PT&& elem) noexcept: ND{}, pair{std::move(elem)}, parent{nullptr}{}
+        /**
+         * @brief Construct a new node object whose pair is constructed in place from the given
+         * arguments (e.g. std::piecewise_construct and two tuples). Sets parent to nullptr.
+         * 
+         * @tparam Types
+         * @param args Arguments forwarded to the constructor of the pair.
+         */
+        template<typename ... Types>
+        explicit _node(std::in_place_t, Types&& ... args): ND{}, pair(std::forward<Types>(args)...), parent{nullptr}{}
 
         /**
-         * @brief Construct a new node object from a unique pointer to node and a raw pointer to
-         * a parent. Used for the sole purpose of copying a BST like structure. 
+         * @brief Construct a new node object from a node and a raw pointer to a parent. Used for
+         * the sole purpose of copying a BST like structure: the children are copied and linked
+         * by the BST. The per-node data is copied as well, since the copy has the same shape
+         * as the original.
          * 
-         * @param x Unique pointer to node. 
+         * @param x Reference to the node to be copied. 
          * @param p Raw pointer to node.
          */
-        _node(const std::unique_ptr<_node>& x, _node* const p): pair{x->pair},parent{p}{
-            if(x->left){
-                left.reset(new _node{x->left, this});
-            }
-            if(x->right){
-                right.reset( new _node{x->right, this} );
-            }
-        }
+        _node(const _node& x, _node* const p): ND{x}, pair{x.pair},parent{p}{}
         /**
          * @brief Destroy the node object.
          * 
@@ -0,0 +1,93 @@
+#ifndef parallel_h
+#define parallel_h
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Tag selecting the parallel version of an operation of the BST (bulk construction, copy,
+ * balance, for_each), carrying the number of threads to use, the calling one included.
+ */
+struct parallel_policy{
+    std::size_t threads;
+
+    /**
+     * @brief Use the given number of threads. Default: one per hardware thread.
+     */
+    explicit parallel_policy(const std::size_t threads = std::thread::hardware_concurrency()) noexcept:
+        threads{threads ? threads : 1} {}
+};
+
+/**
+ * @brief Type trait telling whether an allocator can be used by several threads at once, so that
+ * the parallel operations may allocate nodes concurrently. True for std::allocator; false otherwise
+ * (e.g. pool_allocator), in which case the nodes are allocated by the calling thread only.
+ */
+template<typename A>
+struct _concurrent_allocator: std::false_type{};
+template<typename T>
+struct _concurrent_allocator<std::allocator<T>>: std::true_type{};
+
+/**
+ * @brief Depth at which a tree is split into independent tasks for a given number of threads:
+ * about 8 tasks per thread, so that threads finishing a small subtree early pick up further ones.
+ */
+inline std::size_t _fork_depth(const std::size_t threads) noexcept {
+    std::size_t depth = 0;
+    while((std::size_t{1} << depth) < 8*threads)
+        ++depth;
+    return depth;
+}
+
+/**
+ * @brief Call function(i) for every i in [0, tasks) on up to threads threads, the calling one
+ * included. The tasks are handed out one at a time through a shared counter, so that the load
+ * balances itself whatever their size. If threads cannot be created, the remaining ones run all the
+ * tasks. If a task throws, the tasks not started yet are skipped, and the first exception is
+ * rethrown once every thread has stopped.
+ *
+ * @param tasks Number of tasks.
+ * @param threads Maximum number of threads.
+ * @param function Callable with the index of a task.
+ */
+template<typename Function>
+void _parallel_for(const std::size_t tasks, const std::size_t threads, Function&& function){
+    std::atomic<std::size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_lock;
+    const auto work = [&]() noexcept {
+        for(auto i = next++; i < tasks; i = next++){
+            try{
+                function(i);
+            }
+            catch(...){
+                std::lock_guard<std::mutex> guard{error_lock};
+                if(!error)
+                    error = std::current_exception();
+                next = tasks;
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    try{
+        const auto extra = std::min(threads, tasks);
+        workers.reserve(extra);
+        for(std::size_t i = 1; i < extra; ++i)
+            workers.emplace_back(work);
+    }
+    catch(...){}
+    work();
+    for(auto& worker: workers)
+        worker.join();
+    if(error)
+        std::rethrow_exception(error);
+}
+
+#endif
@@ -0,0 +1,471 @@
+#ifndef persistent_h
+#define persistent_h
+
+#include <iostream>
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "BST.h"
+
+/**
+ * @brief Node of a persistent_BST. Nodes are never modified once built, hence they can be shared
+ * by any number of versions of the tree.
+ *
+ * @tparam KT Key type.
+ * @tparam VT Value type.
+ */
+template<typename KT, typename VT>
+struct _persistent_node{
+    using pointer = std::shared_ptr<const _persistent_node>;
+
+    std::pair<const KT, VT> pair;
+    pointer left;
+    pointer right;
+    // height of the subtree rooted at the node, 1 for a leaf.
+    std::size_t height;
+
+    template <typename P>
+    _persistent_node(P&& pair, pointer left, pointer right):
+        pair{std::forward<P>(pair)}, left{std::move(left)}, right{std::move(right)},
+        height{1 + std::max(left_height(), right_height())} {}
+
+    std::size_t left_height() const noexcept { return left ? left->height : 0; }
+    std::size_t right_height() const noexcept { return right ? right->height : 0; }
+};
+
+/**
+ * @brief Forward iterator over a persistent_BST. Nodes have no parent link, since they are shared,
+ * hence the iterator keeps the ancestors still to be visited on a stack of O(height) pointers.
+ *
+ * @tparam N Node type.
+ * @tparam O Value type that the iterator points to.
+ */
+template<typename N, typename O>
+class _persistent_iterator{
+    // top is the current node; below it, the ancestors whose left subtree is being visited.
+    std::vector<const N*> stack;
+
+    public:
+    using value_type = O;
+    using reference = value_type &;
+    using pointer = value_type *;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    /**
+     * @brief Construct the end iterator.
+     */
+    _persistent_iterator() = default;
+    /**
+     * @brief Construct an iterator from the path of ancestors of a node, the node being the last one.
+     */
+    explicit _persistent_iterator(std::vector<const N*> stack) noexcept: stack{std::move(stack)} {}
+
+    /**
+     * @brief Push the leftmost path of a subtree on the stack.
+     */
+    void descend(const N* n){
+        for(; n; n = n->left.get())
+            stack.push_back(n);
+    }
+
+    reference operator*() const noexcept { return stack.back()->pair; }
+    pointer operator->() const noexcept { return &**this; }
+
+    _persistent_iterator& operator++(){
+        const auto n = stack.back();
+        stack.pop_back();
+        descend(n->right.get());
+        return *this;
+    }
+    _persistent_iterator operator++(int){
+        auto old = *this;
+        ++(*this);
+        return old;
+    }
+
+    friend bool operator==(const _persistent_iterator& a, const _persistent_iterator& b) noexcept {
+        return a.stack.empty() ? b.stack.empty() : !b.stack.empty() && a.stack.back() == b.stack.back();
+    }
+    friend bool operator!=(const _persistent_iterator& a, const _persistent_iterator& b) noexcept { return !(a == b); }
+};
+
+/**
+ * @brief Persistent binary search tree: a balanced (AVL) tree whose nodes are immutable and shared
+ * between versions.
+ *
+ * insert() and erase() never modify a node: they copy the path from the root to the position of the
+ * key, O(log n) nodes, and link the copies to the untouched subtrees, which are shared with the
+ * previous version. Hence copying a tree, or taking a snapshot(), is O(1): it shares the root. A
+ * snapshot is immutable, since later updates of the tree only build new nodes, and is freed when the
+ * last version using its nodes is destroyed.
+ *
+ * Nodes are reference counted by std::shared_ptr, whose counters are atomic: distinct persistent_BST
+ * objects sharing nodes can be read, updated and destroyed by different threads at once, e.g., a
+ * writer can keep updating its tree while readers work on snapshots of it. A single object, as any
+ * standard container, must not be modified while other threads access it.
+ *
+ * @tparam KT Key type.
+ * @tparam VT Value type.
+ * @tparam F Type of comparison operator. Default: std::less<const KT>.
+ */
+template<typename KT, typename VT, typename F = std::less<const KT>>
+class persistent_BST{
+    using PairType = std::pair<const KT, VT>; // Pair Type
+    using node = _persistent_node<KT, VT>;
+    using pointer = typename node::pointer;
+    using const_iterator = _persistent_iterator<node, const PairType>;
+    using iterator = const_iterator;
+
+    F f;
+    pointer root;
+    std::size_t _size{0};
+
+    /**
+     * @brief Helper function building a node on top of two subtrees whose heights differ by at most two,
+     * rotating if they differ by two so that the result is balanced. Allocates at most three nodes.
+     *
+     * @param pair Pair of the node.
+     * @param left Left subtree.
+     * @param right Right subtree.
+     */
+    template <typename P> static pointer _balance(P&& pair, pointer left, pointer right){
+        const auto lh = left ? left->height : 0;
+        const auto rh = right ? right->height : 0;
+        if(lh > rh + 1){
+            if(left->left_height() >= left->right_height())
+                return std::make_shared<const node>(left->pair, left->left,
+                           std::make_shared<const node>(std::forward<P>(pair), left->right, std::move(right)));
+            const auto& middle = left->right;
+            return std::make_shared<const node>(middle->pair,
+                       std::make_shared<const node>(left->pair, left->left, middle->left),
+                       std::make_shared<const node>(std::forward<P>(pair), middle->right, std::move(right)));
+        }
+        if(rh > lh + 1){
+            if(right->right_height() >= right->left_height())
+                return std::make_shared<const node>(right->pair,
+                           std::make_shared<const node>(std::forward<P>(pair), std::move(left), right->left), right->right);
+            const auto& middle = right->left;
+            return std::make_shared<const node>(middle->pair,
+                       std::make_shared<const node>(std::forward<P>(pair), std::move(left), middle->left),
+                       std::make_shared<const node>(right->pair, middle->right, right->right));
+        }
+        return std::make_shared<const node>(std::forward<P>(pair), std::move(left), std::move(right));
+    }
+
+    /**
+     * @brief Helper function returning the subtree n with a pair inserted. The nodes of n are shared:
+     * only the path to the new node is copied. If the key is already present, n itself is returned.
+     *
+     * @param n Root of the subtree.
+     * @param pair Pair to be inserted.
+     * @param inserted Set to true if the pair was inserted.
+     */
+    template <typename P> pointer _insert(const pointer& n, P&& pair, bool& inserted){
+        if(!n){
+            inserted = true;
+            return std::make_shared<const node>(std::forward<P>(pair), nullptr, nullptr);
+        }
+        if(f(pair.first, n->pair.first)){
+            auto left = _insert(n->left, std::forward<P>(pair), inserted);
+            return inserted ? _balance(n->pair, std::move(left), n->right) : n;
+        }
+        if(f(n->pair.first, pair.first)){
+            auto right = _insert(n->right, std::forward<P>(pair), inserted);
+            return inserted ? _balance(n->pair, n->left, std::move(right)) : n;
+        }
+        return n;
+    }
+
+    /**
+     * @brief Helper function returning the subtree n without its leftmost node.
+     *
+     * @param n Root of the subtree, not null.
+     */
+    static pointer _erase_leftmost(const pointer& n){
+        if(!n->left)
+            return n->right;
+        return _balance(n->pair, _erase_leftmost(n->left), n->right);
+    }
+
+    /**
+     * @brief Helper function returning the subtree n without a given key. The nodes of n are shared:
+     * only the path to the erased node is copied. If the key is not present, n itself is returned.
+     *
+     * @param n Root of the subtree.
+     * @param key Key to be erased.
+     * @param erased Set to true if the key was erased.
+     */
+    template <typename K> pointer _erase(const pointer& n, const K& key, bool& erased){
+        if(!n)
+            return n;
+        if(f(key, n->pair.first)){
+            auto left = _erase(n->left, key, erased);
+            return erased ? _balance(n->pair, std::move(left), n->right) : n;
+        }
+        if(f(n->pair.first, key)){
+            auto right = _erase(n->right, key, erased);
+            return erased ? _balance(n->pair, n->left, std::move(right)) : n;
+        }
+        erased = true;
+        if(!n->left || !n->right)
+            return n->left ? n->left : n->right;
+        // replace the node with its successor.
+        const node* successor = n->right.get();
+        while(successor->left)
+            successor = successor->left.get();
+        return _balance(successor->pair, n->left, _erase_leftmost(n->right));
+    }
+
+    /**
+     * @brief Helper function building a perfectly balanced tree out of the next count pairs of a sorted range.
+     *
+     * @param it Iterator to the first pair, advanced past the last one used.
+     * @param count Number of pairs.
+     */
+    template <typename I> static pointer _build(I& it, const std::size_t count){
+        if(!count)
+            return nullptr;
+        auto left = _build(it, count / 2);
+        const auto& pair = *it;
+        ++it;
+        auto right = _build(it, count - count / 2 - 1);
+        return std::make_shared<const node>(pair, std::move(left), std::move(right));
+    }
+
+    /**
+     * @brief Helper function returning the node with the given key, nullptr if it is not present.
+     *
+     * @tparam K Type comparable with the key type.
+     * @param key Key to be searched.
+     */
+    template <typename K> const node* _find(const K& key) const noexcept {
+        auto n = root.get();
+        while(n){
+            if(f(key, n->pair.first))
+                n = n->left.get();
+            else if(f(n->pair.first, key))
+                n = n->right.get();
+            else
+                return n;
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Helper function returning an iterator to the node with the given key, end() if it is not present.
+     *
+     * @tparam K Type comparable with the key type.
+     * @param key Key to be searched.
+     */
+    template <typename K> const_iterator _find_iterator(const K& key) const {
+        std::vector<const node*> stack;
+        auto n = root.get();
+        while(n){
+            if(f(key, n->pair.first)){
+                stack.push_back(n);
+                n = n->left.get();
+            }
+            else if(f(n->pair.first, key))
+                n = n->right.get();
+            else{
+                stack.push_back(n);
+                return const_iterator{std::move(stack)};
+            }
+        }
+        return end();
+    }
+
+    public:
+
+    /**
+     * @brief Construct an empty tree.
+     *
+     * @param f Comparison operator.
+     */
+    explicit persistent_BST(F f = F{}): f{f} {}
+
+    /**
+     * @brief Construct a persistent tree holding the pairs of a BST, perfectly balanced, in O(n).
+     *
+     * @tparam Policies Policies of the BST (balancing, allocator, diagnostics, augmentation).
+     * @param tree Tree to be copied.
+     * @param f Comparison operator, which must order the keys like the one of the tree.
+     */
+    template <typename ... Policies>
+    explicit persistent_BST(const BST<KT, VT, F, Policies...>& tree, F f = F{}): f{f} {
+        std::size_t count = 0;
+        for(auto it = tree.cbegin(); it != tree.cend(); ++it)
+            ++count;
+        auto it = tree.cbegin();
+        root = _build(it, count);
+        _size = count;
+    }
+
+    // Copies share all the nodes, in O(1). Moves leave the source empty.
+    persistent_BST(const persistent_BST&) = default;
+    persistent_BST& operator=(const persistent_BST&) = default;
+    persistent_BST(persistent_BST&& tree) noexcept: f{std::move(tree.f)}, root{std::move(tree.root)}, _size{tree._size} {
+        tree._size = 0;
+    }
+    persistent_BST& operator=(persistent_BST&& tree) noexcept {
+        if(this == &tree)
+            return *this;
+        f = std::move(tree.f);
+        root = std::move(tree.root);
+        _size = tree._size;
+        tree._size = 0;
+        return *this;
+    }
+
+    /**
+     * @brief Returns a snapshot of the tree in O(1), i.e., a copy sharing all of its nodes.
+     * Later updates of the tree do not affect the snapshot, and vice versa.
+     *
+     * @return persistent_BST
+     */
+    persistent_BST snapshot() const noexcept { return *this; }
+
+    /**
+     * @brief Insert a <key,value> pair, copying the O(log n) nodes on the path to its position.
+     * Snapshots taken before are not affected.
+     *
+     * @param pair Pair to be inserted.
+     * @return bool true if the pair was inserted, false if the key was already present.
+     */
+    bool insert(const PairType& pair){
+        bool inserted = false;
+        root = _insert(root, pair, inserted);
+        _size += inserted;
+        return inserted;
+    }
+    bool insert(PairType&& pair){
+        bool inserted = false;
+        root = _insert(root, std::move(pair), inserted);
+        _size += inserted;
+        return inserted;
+    }
+    /**
+     * @brief Insert a pair constructed in place from the given arguments.
+     *
+     * @param args Arguments of the constructor of the pair.
+     * @return bool true if the pair was inserted, false if the key was already present.
+     */
+    template<class... Types>
+    bool emplace(Types&& ... args) { return insert(PairType{std::forward<Types>(args)...}); }
+
+    /**
+     * @brief Erase the node with a given key, copying the O(log n) nodes on the path to it.
+     * Snapshots taken before are not affected.
+     *
+     * @param key Key to be erased.
+     */
+    void erase(const KT& key){
+        bool erased = false;
+        root = _erase(root, key, erased);
+        _size -= erased;
+    }
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    void erase(const K& key){
+        bool erased = false;
+        root = _erase(root, key, erased);
+        _size -= erased;
+    }
+
+    /**
+     * @brief Empty the tree. Nodes shared with snapshots are freed with the last of them.
+     */
+    void clear() noexcept {
+        root.reset();
+        _size = 0;
+    }
+
+    /**
+     * @brief Returns the number of pairs of the tree.
+     *
+     * @return std::size_t
+     */
+    std::size_t size() const noexcept { return _size; }
+    bool empty() const noexcept { return !_size; }
+    /**
+     * @brief Returns the height of the tree, 0 if it is empty.
+     *
+     * @return std::size_t
+     */
+    std::size_t height() const noexcept { return root ? root->height : 0; }
+
+    /**
+     * @brief Finds a given key. If the key is present, returns an iterator to the proper pair,
+     * end() otherwise.
+     *
+     * @param key Key to be found.
+     * @return const_iterator
+     */
+    const_iterator find(const KT& key) const { return _find_iterator(key); }
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    const_iterator find(const K& key) const { return _find_iterator(key); }
+    /**
+     * @brief Returns the number of pairs with the given key, i.e., 1 if the key is present and 0 otherwise.
+     *
+     * @param key
+     * @return std::size_t
+     */
+    std::size_t count(const KT& key) const noexcept { return _find(key) ? 1 : 0; }
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    std::size_t count(const K& key) const noexcept { return _find(key) ? 1 : 0; }
+    /**
+     * @brief Returns true if the key is present in the tree, false otherwise.
+     *
+     * @param key
+     * @return bool
+     */
+    bool contains(const KT& key) const noexcept { return _find(key) != nullptr; }
+    template <typename K, typename G = F, typename = typename G::is_transparent>
+    bool contains(const K& key) const noexcept { return _find(key) != nullptr; }
+
+    /**
+     * @brief Returns iterator to the beginning of the tree. Iterators stay valid as long as a version
+     * of the tree holding their node exists.
+     *
+     * @return const_iterator
+     */
+    const_iterator begin() const {
+        const_iterator it;
+        it.descend(root.get());
+        return it;
+    }
+    const_iterator cbegin() const { return begin(); }
+    /**
+     * @brief Returns iterator to end of the tree.
+     *
+     * @return const_iterator
+     */
+    const_iterator end() const noexcept { return const_iterator{}; }
+    const_iterator cend() const noexcept { return end(); }
+
+    /**
+     * @brief Overload of operator put-to. Same format as the one of BST.
+     *
+     * @param os Reference to std::ostream.
+     * @param tree Const reference to the tree.
+     * @return std::ostream&
+     */
+    friend std::ostream &operator<<(std::ostream &os, const persistent_BST &tree){
+        if(!tree._size){
+            os << "BST is empty => size: [0] \n";
+            return os;
+        }
+        os << "size: [" << tree._size << "] ";
+        for(const auto& el : tree)
+            os << el.first << " ";
+        os << "\n";
+        return os;
+    }
+};
+
+#endif
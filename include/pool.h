@@ -0,0 +1,227 @@
+#ifndef pool_h
+#define pool_h
+
+#include <cstddef>
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief Type trait telling whether an allocator can release all its memory at once through a
+ * member function release(), like pool_allocator.
+ */
+template<typename A, typename = void>
+struct _has_release: std::false_type{};
+template<typename A>
+struct _has_release<A, std::void_t<decltype(std::declval<A&>().release())>>: std::true_type{};
+
+/**
+ * @brief Slab allocator of fixed-size blocks. Memory is obtained from the system in large slabs
+ * and handed out one block at a time. Freed blocks are kept in a free list and reused by the
+ * following allocations, so that a tree with a lot of churn does not hit malloc at all once it
+ * has reached its peak size. All the slabs can be released at once in O(slabs).
+ *
+ * The block size is fixed by the first allocation, which is the size of the nodes of the tree
+ * using the pool.
+ */
+class node_pool{
+    /**
+     * @brief A free block stores the pointer to the next free block.
+     */
+    struct free_block{
+        free_block* next;
+    };
+    /**
+     * @brief Header placed at the beginning of every slab, which links all the slabs together.
+     */
+    struct alignas(std::max_align_t) slab{
+        slab* next;
+    };
+
+    std::size_t slab_bytes;
+    std::size_t block_size{0};
+    slab* slabs{nullptr};
+    free_block* free_list{nullptr};
+    // blocks of the newest slab which have never been handed out.
+    char* cursor{nullptr};
+    char* slab_end{nullptr};
+
+    /**
+     * @brief Helper function to get a new slab from the system.
+     */
+    void _grow(){
+        const auto bytes = sizeof(slab) + std::max(slab_bytes, block_size);
+        auto s = static_cast<slab*>(::operator new(bytes));
+        s->next = slabs;
+        slabs = s;
+        cursor = reinterpret_cast<char*>(s + 1);
+        slab_end = reinterpret_cast<char*>(s) + bytes;
+    }
+
+    public:
+
+    /**
+     * @brief Construct a new pool object.
+     *
+     * @param slab_bytes Size in bytes of each slab requested to the system. Default: 64 KiB.
+     */
+    explicit node_pool(const std::size_t slab_bytes = 64 * 1024) noexcept: slab_bytes{slab_bytes} {}
+
+    node_pool(const node_pool&) = delete;
+    node_pool& operator=(const node_pool&) = delete;
+
+    /**
+     * @brief Destroy the pool object, releasing all the slabs.
+     */
+    ~node_pool() noexcept { release(); }
+
+    /**
+     * @brief Returns true if a block of this size can be served by the pool. The first request
+     * fixes the block size of the pool.
+     *
+     * @param bytes Size of the requested block.
+     */
+    bool serves(const std::size_t bytes) noexcept {
+        if(!block_size){
+            constexpr auto align = alignof(std::max_align_t);
+            block_size = (std::max(bytes, sizeof(free_block)) + align - 1) / align * align;
+        }
+        return bytes <= block_size;
+    }
+
+    /**
+     * @brief Allocate a block, reusing a free one if possible.
+     *
+     * @return void* Pointer to the block, aligned to alignof(std::max_align_t).
+     */
+    void* allocate(){
+        if(free_list){
+            auto block = free_list;
+            free_list = block->next;
+            return block;
+        }
+        if(cursor + block_size > slab_end)
+            _grow();
+        auto block = cursor;
+        cursor += block_size;
+        return block;
+    }
+
+    /**
+     * @brief Give a block back to the pool. The block is pushed on the free list.
+     *
+     * @param p Pointer to a block obtained from allocate().
+     */
+    void deallocate(void* const p) noexcept {
+        auto block = static_cast<free_block*>(p);
+        block->next = free_list;
+        free_list = block;
+    }
+
+    /**
+     * @brief Release all the slabs at once. Every block handed out by the pool becomes invalid.
+     */
+    void release() noexcept {
+        while(slabs){
+            auto next = slabs->next;
+            ::operator delete(slabs);
+            slabs = next;
+        }
+        free_list = nullptr;
+        cursor = slab_end = nullptr;
+    }
+
+    /**
+     * @brief Size in bytes of the slabs.
+     */
+    std::size_t slab_size() const noexcept { return slab_bytes; }
+};
+
+/**
+ * @brief Standard-conforming allocator backed by a node_pool. Copies of the allocator (including
+ * the rebound ones) share the same pool. Single-object requests are served by the pool,
+ * array requests are forwarded to operator new.
+ *
+ * A container that is the sole owner of its pool can call release() to drop all its memory at
+ * once instead of deallocating one object at a time.
+ *
+ * @tparam T Type of the allocated objects.
+ */
+template<typename T>
+class pool_allocator{
+    template<typename U> friend class pool_allocator;
+
+    std::shared_ptr<node_pool> pool;
+
+    public:
+    using value_type = T;
+    // every container gets its own pool on copy, while moves take the pool along.
+    using propagate_on_container_copy_assignment = std::false_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    /**
+     * @brief Construct a new pool_allocator object with a new pool.
+     *
+     * @param slab_bytes Size in bytes of each slab of the pool.
+     */
+    explicit pool_allocator(const std::size_t slab_bytes = 64 * 1024): pool{std::make_shared<node_pool>(slab_bytes)} {}
+    /**
+     * @brief Copy constructor. The copy shares the pool. There is no move constructor, so that
+     * a moved-from allocator keeps on being usable.
+     */
+    pool_allocator(const pool_allocator&) noexcept = default;
+    /**
+     * @brief Construct a new pool_allocator object from an allocator of another type, sharing its pool.
+     */
+    template<typename U> pool_allocator(const pool_allocator<U>& other) noexcept: pool{other.pool} {}
+    pool_allocator& operator=(const pool_allocator&) noexcept = default;
+
+    T* allocate(const std::size_t n){
+        if(n == 1 && alignof(T) <= alignof(std::max_align_t) && pool->serves(sizeof(T)))
+            return static_cast<T*>(pool->allocate());
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* const p, const std::size_t n) noexcept {
+        if(n == 1 && alignof(T) <= alignof(std::max_align_t) && pool->serves(sizeof(T)))
+            pool->deallocate(p);
+        else
+            ::operator delete(p);
+    }
+
+    /**
+     * @brief A copied container gets a fresh pool, with the same slab size.
+     */
+    pool_allocator select_on_container_copy_construction() const {
+        return pool_allocator{pool->slab_size()};
+    }
+
+    /**
+     * @brief Release all the memory of the pool at once, provided that this allocator is the
+     * only one using it. No destructor is run.
+     *
+     * @return true if the memory has been released, false if the pool is shared.
+     */
+    bool release() noexcept {
+        if(pool.use_count() != 1)
+            return false;
+        pool->release();
+        return true;
+    }
+
+    /**
+     * @brief Two allocators are equal if they share the same pool.
+     */
+    template<typename U> bool operator==(const pool_allocator<U>& other) const noexcept {
+        return pool == other.pool;
+    }
+    template<typename U> bool operator!=(const pool_allocator<U>& other) const noexcept {
+        return !(*this == other);
+    }
+};
+
+#endif
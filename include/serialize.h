@@ -0,0 +1,550 @@
+#ifndef serialize_h
+#define serialize_h
+
+#include <iostream>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Binary format of a tree, for trivially copyable key and value types.
+ *
+ * A file is made of a header (see _serial_header) padded to 64 bytes, followed by the pairs of the tree
+ * as an array of records {key, value}, stored with the layout of the machine writing them (byte order,
+ * sizes, padding, all checked when the file is read). The records come in one of two orders:
+ * - `serial_layout::sorted`: sorted by key. A lookup is a binary search.
+ * - `serial_layout::eytzinger`: the breadth-first order of a perfectly balanced tree, i.e., the children
+ *   of the record at position k, counting from 1, are at 2k and 2k+1 (see eytzinger_layout in frozen.h).
+ *   A lookup walks the array from the front, so its first levels share a few pages and cache lines.
+ */
+enum class serial_layout: std::uint32_t{ sorted = 0, eytzinger = 1 };
+
+// version of the format, to be increased on any change of the header or of the records.
+constexpr std::uint32_t serial_version = 1;
+
+/**
+ * @brief Header of a serialized tree.
+ */
+struct _serial_header{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t layout;
+    std::uint64_t count;
+    // 0x01020304 as written by the machine, to detect a different byte order.
+    std::uint32_t byte_order;
+    std::uint32_t key_size;
+    std::uint32_t value_size;
+    std::uint32_t record_size;
+    std::uint32_t record_align;
+};
+
+// offset of the first record in the file. The mapping of a file starts on a page boundary, so the
+// records are aligned to 64 bytes.
+constexpr std::size_t _serial_offset = 64;
+static_assert(sizeof(_serial_header) <= _serial_offset, "The header must fit before the records.");
+
+// number of records written or read at once by save() and load() when streaming.
+constexpr std::size_t _serial_block = 4096;
+
+constexpr char _serial_magic[8] = {'B', 'S', 'T', 'B', 'I', 'N', '\0', '\0'};
+
+/**
+ * @brief Record of a serialized tree. The members are named like the ones of a pair, so that the
+ * records of a mapped_BST are used like the pairs of a BST.
+ *
+ * @tparam KT Key type.
+ * @tparam VT Value type.
+ */
+template<typename KT, typename VT>
+struct _serial_record{
+    static_assert(std::is_trivially_copyable<KT>::value && std::is_trivially_copyable<VT>::value,
+                  "Only trivially copyable key and value types can be serialized.");
+    static_assert(alignof(KT) <= _serial_offset && alignof(VT) <= _serial_offset,
+                  "The records must be aligned to at most 64 bytes.");
+    KT first;
+    VT second;
+
+    /**
+     * @brief Conversion to the pair type of the BST, used to load a tree.
+     */
+    operator std::pair<const KT, VT>() const { return {first, second}; }
+};
+
+/**
+ * @brief Helper function returning the header describing count records of a given layout.
+ */
+template<typename KT, typename VT>
+_serial_header _make_serial_header(const serial_layout layout, const std::uint64_t count) noexcept {
+    _serial_header header{};
+    std::memcpy(header.magic, _serial_magic, sizeof(header.magic));
+    header.version = serial_version;
+    header.layout = static_cast<std::uint32_t>(layout);
+    header.count = count;
+    header.byte_order = 0x01020304;
+    header.key_size = sizeof(KT);
+    header.value_size = sizeof(VT);
+    header.record_size = sizeof(_serial_record<KT, VT>);
+    header.record_align = alignof(_serial_record<KT, VT>);
+    return header;
+}
+
+/**
+ * @brief Helper function checking that a header describes records of the given types written by a
+ * machine with the same layout, and returning the layout of the records. Throws std::runtime_error
+ * otherwise.
+ */
+template<typename KT, typename VT>
+serial_layout _check_serial_header(const _serial_header& header){
+    const auto expected = _make_serial_header<KT, VT>(serial_layout::sorted, 0);
+    if(std::memcmp(header.magic, expected.magic, sizeof(header.magic)))
+        throw std::runtime_error{"Not a serialized BST."};
+    if(header.version != serial_version)
+        throw std::runtime_error{"Unsupported version " + std::to_string(header.version) + " of the serialized BST."};
+    if(header.byte_order != expected.byte_order || header.key_size != expected.key_size ||
+       header.value_size != expected.value_size || header.record_size != expected.record_size ||
+       header.record_align != expected.record_align)
+        throw std::runtime_error{"The serialized BST has different key or value types, or was written by a different architecture."};
+    if(header.layout > static_cast<std::uint32_t>(serial_layout::eytzinger))
+        throw std::runtime_error{"Unknown layout of the serialized BST."};
+    return static_cast<serial_layout>(header.layout);
+}
+
+/**
+ * @brief Forward iterator over an array of records stored with either layout, in ascending order of
+ * key. It walks the array for the sorted layout and the implicit tree for the Eytzinger one, in
+ * amortized O(1) per step and without any extra memory.
+ *
+ * @tparam R Record type.
+ */
+template<typename R>
+class _serial_iterator{
+    const R* records;
+    std::size_t count;
+    // position of the record, counting from 1; 0 is the end.
+    std::size_t k;
+    bool eytzinger;
+
+    public:
+    using value_type = const R;
+    using reference = value_type &;
+    using pointer = value_type *;
+    using difference_type = std::ptrdiff_t;
+    using iterator_category = std::forward_iterator_tag;
+
+    /**
+     * @brief Construct an iterator to the record at position k (counting from 1, 0 for the end) of an array.
+     */
+    _serial_iterator(const R* records = nullptr, const std::size_t count = 0, const std::size_t k = 0,
+                     const bool eytzinger = false) noexcept:
+        records{records}, count{count}, k{k}, eytzinger{eytzinger} {}
+
+    reference operator*() const noexcept { return records[k-1]; }
+    pointer operator->() const noexcept { return &**this; }
+
+    _serial_iterator& operator++() noexcept {
+        if(!eytzinger){
+            k = k < count ? k + 1 : 0;
+        }
+        else if(2*k + 1 <= count){
+            // leftmost position of the right subtree.
+            k = 2*k + 1;
+            while(2*k <= count)
+                k *= 2;
+        }
+        else{
+            // climb while the position is a right child, then once more.
+            while(k & 1)
+                k >>= 1;
+            k >>= 1;
+        }
+        return *this;
+    }
+    _serial_iterator operator++(int) noexcept {
+        auto old = *this;
+        ++(*this);
+        return old;
+    }
+
+    friend bool operator==(const _serial_iterator& a, const _serial_iterator& b) noexcept { return a.k == b.k; }
+    friend bool operator!=(const _serial_iterator& a, const _serial_iterator& b) noexcept { return !(a == b); }
+};
+
+/**
+ * @brief Helper function returning the position (counting from 1, 0 if there is none) of the record
+ * with the least key of an array: the first one for the sorted layout, the leftmost position of the
+ * implicit tree for the Eytzinger one.
+ */
+inline std::size_t _serial_first(const std::size_t count, const serial_layout layout) noexcept {
+    if(!count)
+        return 0;
+    std::size_t k = 1;
+    if(layout == serial_layout::eytzinger)
+        while(2*k <= count)
+            k *= 2;
+    return k;
+}
+
+/**
+ * @brief Helper function returning the position (counting from 1, 0 if there is none) of the first
+ * record of an array for which pred is false, pred being true for a prefix of the records in order.
+ *
+ * @param records Array of records.
+ * @param count Number of records.
+ * @param layout Order of the records.
+ * @param pred Predicate on the key of a record.
+ */
+template<typename R, typename Pred>
+std::size_t _serial_partition(const R* records, const std::size_t count, const serial_layout layout, Pred&& pred){
+    if(layout == serial_layout::sorted){
+        const auto it = std::partition_point(records, records + count, [&pred](const R& r){ return pred(r.first); });
+        return it == records + count ? 0 : static_cast<std::size_t>(it - records) + 1;
+    }
+    std::size_t k = 1;
+    while(k <= count)
+        k = 2*k + pred(records[k-1].first);
+    // the answer is the last position from which the descent went left.
+    while(k & 1)
+        k >>= 1;
+    return k >> 1;
+}
+
+/**
+ * @brief Helper function filling an array in Eytzinger order with the records of a sorted range,
+ * visiting the implicit tree in order.
+ */
+template<typename R, typename It>
+void _serial_fill(std::vector<R>& out, const std::size_t k, It& it){
+    if(k > out.size())
+        return;
+    _serial_fill(out, 2*k, it);
+    out[k-1].first = it->first;
+    out[k-1].second = it->second;
+    ++it;
+    _serial_fill(out, 2*k + 1, it);
+}
+
+/**
+ * @brief Write a tree (a BST, or any container iterating over pairs in ascending order of key) to a
+ * stream, in the binary format described above. The stream must be opened in binary mode. Throws
+ * std::runtime_error if writing fails.
+ *
+ * @param tree Tree to be written.
+ * @param os Output stream.
+ * @param layout Order of the records. Default: sorted.
+ */
+template<typename Tree>
+void save(const Tree& tree, std::ostream& os, const serial_layout layout = serial_layout::sorted){
+    using KT = std::remove_const_t<typename std::iterator_traits<decltype(tree.cbegin())>::value_type::first_type>;
+    using VT = typename std::iterator_traits<decltype(tree.cbegin())>::value_type::second_type;
+    using record = _serial_record<KT, VT>;
+
+    const auto count = static_cast<std::uint64_t>(std::distance(tree.cbegin(), tree.cend()));
+    const auto header = _make_serial_header<KT, VT>(layout, count);
+    char padding[_serial_offset] = {};
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    os.write(padding, _serial_offset - sizeof(header));
+
+    // records are value-initialized, so that their padding bytes are written as zeros.
+    std::vector<record> buffer;
+    if(layout == serial_layout::eytzinger){
+        buffer.resize(count);
+        auto it = tree.cbegin();
+        _serial_fill(buffer, 1, it);
+        os.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(count * sizeof(record)));
+    }
+    else{
+        // the sorted layout is streamed in blocks of records.
+        constexpr std::size_t block = _serial_block;
+        buffer.reserve(block);
+        for(auto it = tree.cbegin(); it != tree.cend(); ++it){
+            buffer.emplace_back();
+            buffer.back().first = it->first;
+            buffer.back().second = it->second;
+            if(buffer.size() == block){
+                os.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(block * sizeof(record)));
+                buffer.clear();
+            }
+        }
+        os.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size() * sizeof(record)));
+    }
+    if(!os)
+        throw std::runtime_error{"Failed to write the serialized BST."};
+}
+
+/**
+ * @brief Write a tree to a file (see save(tree, os, layout)).
+ */
+template<typename Tree>
+void save(const Tree& tree, const std::string& path, const serial_layout layout = serial_layout::sorted){
+    std::ofstream os{path, std::ios::binary | std::ios::trunc};
+    if(!os)
+        throw std::runtime_error{"Cannot open " + path + " for writing."};
+    save(tree, os, layout);
+    os.close();
+    if(!os)
+        throw std::runtime_error{"Failed to write " + path + "."};
+}
+
+/**
+ * @brief Read a tree written by save() from a stream opened in binary mode, and build it in O(n) with
+ * the sorted range constructor: e.g. `auto tree = load<BST<int, int>>(is);`. The key and value types
+ * of Tree must be the ones of the saved tree, and its comparison operator must order the keys in the
+ * same way. Throws std::runtime_error if the stream does not hold such a tree, or holds fewer records
+ * than its header counts.
+ *
+ * @tparam Tree Type of the tree, constructible from a range of pairs sorted by key.
+ * @param is Input stream.
+ * @param args Further arguments of the constructor of the tree (comparison operator, allocator).
+ * @return Tree
+ */
+template<typename Tree, typename ... Types>
+Tree load(std::istream& is, Types&& ... args){
+    using KT = std::remove_const_t<typename std::iterator_traits<decltype(std::declval<const Tree&>().cbegin())>::value_type::first_type>;
+    using VT = typename std::iterator_traits<decltype(std::declval<const Tree&>().cbegin())>::value_type::second_type;
+    using record = _serial_record<KT, VT>;
+
+    _serial_header header;
+    char padding[_serial_offset];
+    if(!is.read(reinterpret_cast<char*>(&header), sizeof(header)) || !is.read(padding, _serial_offset - sizeof(header)))
+        throw std::runtime_error{"Truncated serialized BST."};
+    const auto layout = _check_serial_header<KT, VT>(header);
+    // the count is read from the stream, so it is checked against the remaining length when the stream
+    // can seek, and the records are read in blocks otherwise: a wrong count fails before a large allocation.
+    std::vector<record> records;
+    if(header.count > records.max_size())
+        throw std::runtime_error{"Truncated serialized BST."};
+    const auto start = is.tellg();
+    if(start != std::istream::pos_type(-1)){
+        is.seekg(0, std::ios::end);
+        const std::streamoff remaining = is.tellg() - start;
+        is.seekg(start);
+        if(!is || remaining < 0 || static_cast<std::uint64_t>(remaining) / sizeof(record) < header.count)
+            throw std::runtime_error{"Truncated serialized BST."};
+        records.reserve(static_cast<std::size_t>(header.count));
+    }
+    while(records.size() < header.count){
+        const auto size = records.size();
+        const auto n = static_cast<std::size_t>(std::min<std::uint64_t>(header.count - size, _serial_block));
+        records.resize(size + n);
+        if(!is.read(reinterpret_cast<char*>(records.data() + size), static_cast<std::streamsize>(n * sizeof(record))))
+            throw std::runtime_error{"Truncated serialized BST."};
+    }
+    const bool eytzinger = layout == serial_layout::eytzinger;
+    const _serial_iterator<record> first{records.data(), records.size(), _serial_first(records.size(), layout), eytzinger};
+    const _serial_iterator<record> last{records.data(), records.size(), 0, eytzinger};
+    return Tree(first, last, std::forward<Types>(args)...);
+}
+
+/**
+ * @brief Read a tree from a file (see load(is, args)).
+ */
+template<typename Tree, typename ... Types>
+Tree load(const std::string& path, Types&& ... args){
+    std::ifstream is{path, std::ios::binary};
+    if(!is)
+        throw std::runtime_error{"Cannot open " + path + " for reading."};
+    return load<Tree>(is, std::forward<Types>(args)...);
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+/**
+ * @brief Read-only view of a tree saved to a file by save(), mapped into memory with mmap.
+ *
+ * Opening the view reads nothing but the header: the lookups and the iterators work on the records in
+ * the mapped pages, which the operating system loads on first access and shares between the processes
+ * mapping the same file, so a large table is available at once after a restart. The records are
+ * `{first, second}` structs with the members of a pair. The file must not be modified while mapped.
+ *
+ * @tparam KT Key type.
+ * @tparam VT Value type.
+ * @tparam F Type of comparison operator, which must order the keys like the one of the saved tree.
+ * Default: std::less<const KT>.
+ */
+template<typename KT, typename VT, typename F = std::less<const KT>>
+class mapped_BST{
+    using record = _serial_record<KT, VT>;
+    using const_iterator = _serial_iterator<record>;
+    using iterator = const_iterator;
+
+    F f;
+    void* map{nullptr};
+    std::size_t length{0};
+    const record* records{nullptr};
+    std::size_t _size{0};
+    serial_layout _layout{serial_layout::sorted};
+
+    void _unmap() noexcept {
+        if(map)
+            munmap(map, length);
+        map = nullptr;
+    }
+    const_iterator _at(const std::size_t k) const noexcept {
+        return const_iterator{records, _size, k, _layout == serial_layout::eytzinger};
+    }
+
+    public:
+
+    /**
+     * @brief Map a file written by save(). Throws std::runtime_error if the file cannot be mapped, or
+     * does not hold a tree with the given key and value types.
+     *
+     * @param path Path of the file.
+     * @param f Comparison operator.
+     */
+    explicit mapped_BST(const std::string& path, F f = F{}): f{f} {
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd < 0)
+            throw std::runtime_error{"Cannot open " + path + " for reading."};
+        struct stat status;
+        if(::fstat(fd, &status) < 0 || static_cast<std::size_t>(status.st_size) < _serial_offset){
+            ::close(fd);
+            throw std::runtime_error{"Truncated serialized BST " + path + "."};
+        }
+        length = static_cast<std::size_t>(status.st_size);
+        map = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        // the mapping keeps the file alive.
+        ::close(fd);
+        if(map == MAP_FAILED){
+            map = nullptr;
+            throw std::runtime_error{"Cannot map " + path + "."};
+        }
+        try{
+            _serial_header header;
+            std::memcpy(&header, map, sizeof(header));
+            _layout = _check_serial_header<KT, VT>(header);
+            if((length - _serial_offset) / sizeof(record) < header.count)
+                throw std::runtime_error{"Truncated serialized BST " + path + "."};
+            _size = static_cast<std::size_t>(header.count);
+            records = reinterpret_cast<const record*>(static_cast<const char*>(map) + _serial_offset);
+        }
+        catch(...){
+            _unmap();
+            throw;
+        }
+    }
+
+    // The view owns its mapping: it can be moved but not copied.
+    mapped_BST(const mapped_BST&) = delete;
+    mapped_BST& operator=(const mapped_BST&) = delete;
+    mapped_BST(mapped_BST&& view) noexcept: f{std::move(view.f)}, map{view.map}, length{view.length},
+        records{view.records}, _size{view._size}, _layout{view._layout} {
+        view.map = nullptr;
+        view.records = nullptr;
+        view._size = 0;
+    }
+    mapped_BST& operator=(mapped_BST&& view) noexcept {
+        if(this == &view)
+            return *this;
+        _unmap();
+        f = std::move(view.f);
+        map = view.map;
+        length = view.length;
+        records = view.records;
+        _size = view._size;
+        _layout = view._layout;
+        view.map = nullptr;
+        view.records = nullptr;
+        view._size = 0;
+        return *this;
+    }
+    ~mapped_BST() noexcept { _unmap(); }
+
+    /**
+     * @brief Returns the number of pairs of the tree.
+     *
+     * @return std::size_t
+     */
+    std::size_t size() const noexcept { return _size; }
+    bool empty() const noexcept { return !_size; }
+    /**
+     * @brief Returns the order of the records in the file.
+     *
+     * @return serial_layout
+     */
+    serial_layout layout() const noexcept { return _layout; }
+
+    /**
+     * @brief Returns an iterator to the first record whose key is not less than (greater than) key,
+     * end() if there is none.
+     *
+     * @tparam K Type comparable with the key type.
+     * @param key
+     * @return const_iterator
+     */
+    template <typename K> const_iterator lower_bound(const K& key) const {
+        return _at(_serial_partition(records, _size, _layout, [this, &key](const KT& x){ return f(x, key); }));
+    }
+    template <typename K> const_iterator upper_bound(const K& key) const {
+        return _at(_serial_partition(records, _size, _layout, [this, &key](const KT& x){ return !f(key, x); }));
+    }
+    /**
+     * @brief Finds a given key. If the key is present, returns an iterator to the proper record,
+     * end() otherwise.
+     *
+     * @tparam K Type comparable with the key type.
+     * @param key Key to be found.
+     * @return const_iterator
+     */
+    template <typename K> const_iterator find(const K& key) const {
+        const auto it = lower_bound(key);
+        return it != end() && !f(key, it->first) ? it : end();
+    }
+    /**
+     * @brief Returns the number of records with the given key, i.e., 1 if the key is present and 0 otherwise.
+     */
+    template <typename K> std::size_t count(const K& key) const { return find(key) != end(); }
+    template <typename K> bool contains(const K& key) const { return find(key) != end(); }
+
+    /**
+     * @brief Returns iterator to the beginning of the tree.
+     *
+     * @return const_iterator
+     */
+    const_iterator begin() const noexcept { return _at(_serial_first(_size, _layout)); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    /**
+     * @brief Returns iterator to end of the tree.
+     *
+     * @return const_iterator
+     */
+    const_iterator end() const noexcept { return _at(0); }
+    const_iterator cend() const noexcept { return end(); }
+
+    /**
+     * @brief Overload of operator put-to. Same format as the one of BST.
+     *
+     * @param os Reference to std::ostream.
+     * @param view Const reference to the view.
+     * @return std::ostream&
+     */
+    friend std::ostream &operator<<(std::ostream &os, const mapped_BST &view){
+        if(view.empty()){
+            os << "BST is empty => size: [0] \n";
+            return os;
+        }
+        os << "size: [" << view.size() << "] ";
+        for(const auto& el : view)
+            os << el.first << " ";
+        os << "\n";
+        return os;
+    }
+};
+#endif
+
+#endif
@@ -0,0 +1,239 @@
+#ifndef simd_h
+#define simd_h
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief Kernels counting, inside a block of sorted keys filling a cache line, how many keys are
+ * less than (or greater than) a given key, used by simd_block_layout (see frozen.h).
+ *
+ * The implementation is picked at compile time from the key type and the instruction sets enabled
+ * by the compiler flags (e.g. -mavx2 or -march=native):
+ * - 4-byte integers: AVX2, or SSE2 (always available on x86-64);
+ * - 8-byte integers: AVX2, or SSE4.2;
+ * - anything else: a branchless scalar loop, which the compiler is free to vectorize.
+ * Unsigned keys are compared as signed ones after flipping their sign bit.
+ */
+
+/**
+ * @brief Number of keys of type KT in a block, i.e., in a 64-byte cache line.
+ */
+template<typename KT>
+constexpr std::size_t _block_size = sizeof(KT) < 64 ? 64 / sizeof(KT) : 1;
+
+/**
+ * @brief Scalar kernel, used when no SIMD kernel is available for the key type.
+ *
+ * @tparam KT Key type.
+ */
+template<typename KT, typename = void>
+struct _block_search{
+    static constexpr bool vectorized = false;
+
+    /**
+     * @brief Number of keys of the block less than x.
+     */
+    static std::size_t count_less(const KT* const block, const KT x) noexcept {
+        std::size_t count = 0;
+        for(std::size_t i = 0; i < _block_size<KT>; ++i)
+            count += block[i] < x;
+        return count;
+    }
+    /**
+     * @brief Number of keys of the block greater than x.
+     */
+    static std::size_t count_greater(const KT* const block, const KT x) noexcept {
+        std::size_t count = 0;
+        for(std::size_t i = 0; i < _block_size<KT>; ++i)
+            count += x < block[i];
+        return count;
+    }
+};
+
+#if defined(__AVX2__)
+
+/**
+ * @brief AVX2 kernel for 4-byte integers: two 8-lane comparisons per block.
+ */
+template<typename KT>
+struct _block_search<KT, std::enable_if_t<std::is_integral<KT>::value && sizeof(KT) == 4>>{
+    static constexpr bool vectorized = true;
+
+    static __m256i _load(const KT* const p) noexcept {
+        const auto v = _mm256_load_si256(reinterpret_cast<const __m256i*>(p));
+        if constexpr (std::is_signed<KT>::value)
+            return v;
+        else
+            return _mm256_xor_si256(v, _mm256_set1_epi32(INT32_MIN));
+    }
+    static __m256i _broadcast(const KT x) noexcept {
+        return _mm256_set1_epi32(static_cast<std::int32_t>(std::is_signed<KT>::value ? x : x ^ 0x80000000u));
+    }
+    static unsigned _mask(const __m256i gt) noexcept {
+        return static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(gt)));
+    }
+
+    static std::size_t count_less(const KT* const block, const KT x) noexcept {
+        const auto v = _broadcast(x);
+        const auto mask = _mask(_mm256_cmpgt_epi32(v, _load(block))) |
+                          _mask(_mm256_cmpgt_epi32(v, _load(block + 8))) << 8;
+        return std::bitset<16>(mask).count();
+    }
+    static std::size_t count_greater(const KT* const block, const KT x) noexcept {
+        const auto v = _broadcast(x);
+        const auto mask = _mask(_mm256_cmpgt_epi32(_load(block), v)) |
+                          _mask(_mm256_cmpgt_epi32(_load(block + 8), v)) << 8;
+        return std::bitset<16>(mask).count();
+    }
+};
+
+/**
+ * @brief AVX2 kernel for 8-byte integers: two 4-lane comparisons per block.
+ */
+template<typename KT>
+struct _block_search<KT, std::enable_if_t<std::is_integral<KT>::value && sizeof(KT) == 8>>{
+    static constexpr bool vectorized = true;
+
+    static __m256i _load(const KT* const p) noexcept {
+        const auto v = _mm256_load_si256(reinterpret_cast<const __m256i*>(p));
+        if constexpr (std::is_signed<KT>::value)
+            return v;
+        else
+            return _mm256_xor_si256(v, _mm256_set1_epi64x(INT64_MIN));
+    }
+    static __m256i _broadcast(const KT x) noexcept {
+        return _mm256_set1_epi64x(static_cast<std::int64_t>(std::is_signed<KT>::value ? x : x ^ 0x8000000000000000u));
+    }
+    static unsigned _mask(const __m256i gt) noexcept {
+        return static_cast<unsigned>(_mm256_movemask_pd(_mm256_castsi256_pd(gt)));
+    }
+
+    static std::size_t count_less(const KT* const block, const KT x) noexcept {
+        const auto v = _broadcast(x);
+        const auto mask = _mask(_mm256_cmpgt_epi64(v, _load(block))) |
+                          _mask(_mm256_cmpgt_epi64(v, _load(block + 4))) << 4;
+        return std::bitset<8>(mask).count();
+    }
+    static std::size_t count_greater(const KT* const block, const KT x) noexcept {
+        const auto v = _broadcast(x);
+        const auto mask = _mask(_mm256_cmpgt_epi64(_load(block), v)) |
+                          _mask(_mm256_cmpgt_epi64(_load(block + 4), v)) << 4;
+        return std::bitset<8>(mask).count();
+    }
+};
+
+#elif defined(__SSE2__)
+
+/**
+ * @brief SSE2 kernel for 4-byte integers: four 4-lane comparisons per block.
+ */
+template<typename KT>
+struct _block_search<KT, std::enable_if_t<std::is_integral<KT>::value && sizeof(KT) == 4>>{
+    static constexpr bool vectorized = true;
+
+    static __m128i _load(const KT* const p) noexcept {
+        const auto v = _mm_load_si128(reinterpret_cast<const __m128i*>(p));
+        if constexpr (std::is_signed<KT>::value)
+            return v;
+        else
+            return _mm_xor_si128(v, _mm_set1_epi32(INT32_MIN));
+    }
+    static __m128i _broadcast(const KT x) noexcept {
+        return _mm_set1_epi32(static_cast<std::int32_t>(std::is_signed<KT>::value ? x : x ^ 0x80000000u));
+    }
+    static unsigned _mask(const __m128i gt) noexcept {
+        return static_cast<unsigned>(_mm_movemask_ps(_mm_castsi128_ps(gt)));
+    }
+
+    static std::size_t count_less(const KT* const block, const KT x) noexcept {
+        const auto v = _broadcast(x);
+        unsigned mask = 0;
+        for(std::size_t i = 0; i < 4; ++i)
+            mask |= _mask(_mm_cmpgt_epi32(v, _load(block + 4*i))) << 4*i;
+        return std::bitset<16>(mask).count();
+    }
+    static std::size_t count_greater(const KT* const block, const KT x) noexcept {
+        const auto v = _broadcast(x);
+        unsigned mask = 0;
+        for(std::size_t i = 0; i < 4; ++i)
+            mask |= _mask(_mm_cmpgt_epi32(_load(block + 4*i), v)) << 4*i;
+        return std::bitset<16>(mask).count();
+    }
+};
+
+#if defined(__SSE4_2__)
+
+/**
+ * @brief SSE4.2 kernel for 8-byte integers: four 2-lane comparisons per block.
+ */
+template<typename KT>
+struct _block_search<KT, std::enable_if_t<std::is_integral<KT>::value && sizeof(KT) == 8>>{
+    static constexpr bool vectorized = true;
+
+    static __m128i _load(const KT* const p) noexcept {
+        const auto v = _mm_load_si128(reinterpret_cast<const __m128i*>(p));
+        if constexpr (std::is_signed<KT>::value)
+            return v;
+        else
+            return _mm_xor_si128(v, _mm_set1_epi64x(INT64_MIN));
+    }
+    static __m128i _broadcast(const KT x) noexcept {
+        return _mm_set1_epi64x(static_cast<std::int64_t>(std::is_signed<KT>::value ? x : x ^ 0x8000000000000000u));
+    }
+    static unsigned _mask(const __m128i gt) noexcept {
+        return static_cast<unsigned>(_mm_movemask_pd(_mm_castsi128_pd(gt)));
+    }
+
+    static std::size_t count_less(const KT* const block, const KT x) noexcept {
+        const auto v = _broadcast(x);
+        unsigned mask = 0;
+        for(std::size_t i = 0; i < 4; ++i)
+            mask |= _mask(_mm_cmpgt_epi64(v, _load(block + 2*i))) << 2*i;
+        return std::bitset<8>(mask).count();
+    }
+    static std::size_t count_greater(const KT* const block, const KT x) noexcept {
+        const auto v = _broadcast(x);
+        unsigned mask = 0;
+        for(std::size_t i = 0; i < 4; ++i)
+            mask |= _mask(_mm_cmpgt_epi64(_load(block + 2*i), v)) << 2*i;
+        return std::bitset<8>(mask).count();
+    }
+};
+
+#endif
+#endif
+
+/**
+ * @brief Allocator returning memory aligned to a cache line, so that every block of keys
+ * fills exactly one line and can be read with aligned SIMD loads.
+ *
+ * @tparam T Type of the allocated objects.
+ */
+template<typename T>
+struct _cache_aligned_allocator{
+    using value_type = T;
+    static constexpr std::align_val_t alignment{64};
+
+    _cache_aligned_allocator() noexcept = default;
+    template<typename U> _cache_aligned_allocator(const _cache_aligned_allocator<U>&) noexcept {}
+
+    T* allocate(const std::size_t n){
+        return static_cast<T*>(::operator new(n * sizeof(T), alignment));
+    }
+    void deallocate(T* const p, const std::size_t) noexcept {
+        ::operator delete(p, alignment);
+    }
+
+    template<typename U> bool operator==(const _cache_aligned_allocator<U>&) const noexcept { return true; }
+    template<typename U> bool operator!=(const _cache_aligned_allocator<U>&) const noexcept { return false; }
+};
+
+#endif
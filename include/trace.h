@@ -0,0 +1,269 @@
+#ifndef trace_h
+#define trace_h
+
+#include <array>
+#include <cstddef>
+#include <map>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @brief Events reported by the BST to its diagnostics policy.
+ */
+enum class trace_event: unsigned char{
+    lvalue_node_ctor, // a node has been constructed from an l-value pair.
+    rvalue_node_ctor, // a node has been constructed from an r-value pair.
+    find_on_empty,    // a key has been looked up in an empty tree.
+    erase_missing,    // erase has been called on a key which is not in the tree.
+};
+
+/**
+ * @brief Number of different trace events.
+ */
+constexpr std::size_t trace_event_count = 4;
+
+/**
+ * @brief Returns a human readable description of a trace event.
+ *
+ * @param e Trace event.
+ * @return const char* Description of the event.
+ */
+constexpr const char* to_string(const trace_event e) noexcept {
+    switch(e){
+        case trace_event::lvalue_node_ctor: return "l-value node ctor";
+        case trace_event::rvalue_node_ctor: return "r-value node ctor";
+        case trace_event::find_on_empty: return "BST is empty.";
+        case trace_event::erase_missing: return "Erase failed. This key does not exist.";
+    }
+    return "";
+}
+
+/**
+ * @brief Operations of the BST whose cost can be reported to its diagnostics policy.
+ */
+enum class trace_operation: unsigned char{
+    find,   // find(), count(), contains().
+    insert, // insert(), emplace(), try_emplace(), insert_or_assign(), operator[] and their hinted versions.
+    erase,  // erase() and extract() of a key.
+};
+
+/**
+ * @brief Number of different trace operations.
+ */
+constexpr std::size_t trace_operation_count = 3;
+
+/**
+ * @brief Returns the name of a trace operation.
+ *
+ * @param op Trace operation.
+ * @return const char* Name of the operation.
+ */
+constexpr const char* to_string(const trace_operation op) noexcept {
+    switch(op){
+        case trace_operation::find: return "find";
+        case trace_operation::insert: return "insert";
+        case trace_operation::erase: return "erase";
+    }
+    return "";
+}
+
+/**
+ * @brief Diagnostics policies for the BST.
+ *
+ * A diagnostics policy is stored inside the tree and receives every trace_event through its member
+ * function `record(e)`. The tree exposes it through `trace()`. Nothing is ever written to a stream.
+ *
+ * A policy which also has a member function `record(op, nodes, comparisons)` receives the cost of every
+ * single-key operation: the number of nodes visited by its descent and the number of key comparisons.
+ * For the other policies the tree does not count anything, so the hot paths are left as they are.
+ * Batched operations (find_batch(), insert_batch()), set algorithms and bulk construction are not
+ * reported.
+ */
+
+/**
+ * @brief Type trait telling whether a diagnostics policy receives the cost of the operations.
+ */
+template<typename Trace, typename = void>
+struct _traces_operations: std::false_type{};
+template<typename Trace>
+struct _traces_operations<Trace, std::void_t<decltype(std::declval<Trace&>().record(trace_operation::find,
+                                                                                      std::size_t{}, std::size_t{}))>>
+    : std::true_type{};
+
+/**
+ * @brief Cost of the descent of an operation, counted by the tree only if the policy receives it. The
+ * disabled counter is empty and counting compiles to nothing.
+ */
+template<bool Enabled>
+struct _operation_counter{
+    void visit(const std::size_t) noexcept {}
+};
+template<>
+struct _operation_counter<true>{
+    std::size_t nodes{0};
+    std::size_t comparisons{0};
+
+    /**
+     * @brief Count a node visited with the given number of key comparisons.
+     */
+    void visit(const std::size_t c) noexcept {
+        ++nodes;
+        comparisons += c;
+    }
+};
+
+/**
+ * @brief Policy that discards every event. Recording compiles to nothing. This is the default.
+ */
+struct no_trace{
+    void record(const trace_event) noexcept {}
+};
+
+/**
+ * @brief Policy that counts how many times every event occurred.
+ */
+class counting_trace{
+    std::array<std::size_t, trace_event_count> counts{};
+
+    public:
+
+    void record(const trace_event e) noexcept { ++counts[static_cast<std::size_t>(e)]; }
+
+    /**
+     * @brief Returns how many times an event has been recorded.
+     */
+    std::size_t count(const trace_event e) const noexcept { return counts[static_cast<std::size_t>(e)]; }
+
+    /**
+     * @brief Reset all the counters to zero.
+     */
+    void reset() noexcept { counts.fill(0); }
+};
+
+/**
+ * @brief Policy that keeps the last N events in a ring buffer.
+ *
+ * @tparam N Capacity of the buffer.
+ */
+template<std::size_t N>
+class ring_buffer_trace{
+    static_assert(N > 0, "The ring buffer must hold at least one event.");
+
+    std::array<trace_event, N> events{};
+    // total number of events recorded so far.
+    std::size_t recorded{0};
+
+    public:
+
+    void record(const trace_event e) noexcept { events[recorded++ % N] = e; }
+
+    /**
+     * @brief Number of events available in the buffer, at most N.
+     */
+    std::size_t size() const noexcept { return recorded < N ? recorded : N; }
+
+    /**
+     * @brief Returns the i-th available event, from the oldest (0) to the newest (size()-1).
+     */
+    trace_event operator[](const std::size_t i) const noexcept {
+        return events[(recorded - size() + i) % N];
+    }
+
+    /**
+     * @brief Drop all the events.
+     */
+    void reset() noexcept { recorded = 0; }
+};
+
+/**
+ * @brief Policy that counts the events like counting_trace and, for every operation, how many times it
+ * has been performed, the key comparisons and the nodes visited, and a histogram of the depth of the
+ * descents (the number of nodes visited by each).
+ */
+class stats_trace: public counting_trace{
+    public:
+
+    /**
+     * @brief Number of buckets of the depth histograms. The last one holds every depth from
+     * depth_buckets-1 up.
+     */
+    static constexpr std::size_t depth_buckets = 64;
+
+    private:
+
+    struct operation_stats{
+        std::size_t operations{0};
+        std::size_t comparisons{0};
+        std::size_t nodes{0};
+        std::array<std::size_t, depth_buckets> depths{};
+    };
+    std::array<operation_stats, trace_operation_count> stats{};
+
+    const operation_stats& _stats(const trace_operation op) const noexcept {
+        return stats[static_cast<std::size_t>(op)];
+    }
+
+    public:
+
+    using counting_trace::record;
+
+    void record(const trace_operation op, const std::size_t nodes, const std::size_t comparisons) noexcept {
+        auto& s = stats[static_cast<std::size_t>(op)];
+        ++s.operations;
+        s.comparisons += comparisons;
+        s.nodes += nodes;
+        ++s.depths[nodes < depth_buckets ? nodes : depth_buckets - 1];
+    }
+
+    /**
+     * @brief Returns how many times an operation has been performed.
+     */
+    std::size_t operations(const trace_operation op) const noexcept { return _stats(op).operations; }
+    /**
+     * @brief Returns the total number of key comparisons of an operation.
+     */
+    std::size_t comparisons(const trace_operation op) const noexcept { return _stats(op).comparisons; }
+    /**
+     * @brief Returns the total number of nodes visited by an operation.
+     */
+    std::size_t nodes_visited(const trace_operation op) const noexcept { return _stats(op).nodes; }
+    /**
+     * @brief Returns the mean number of nodes visited by an operation, 0 if it has never been performed.
+     */
+    double mean_depth(const trace_operation op) const noexcept {
+        const auto& s = _stats(op);
+        return s.operations ? static_cast<double>(s.nodes) / s.operations : 0;
+    }
+    /**
+     * @brief Returns the histogram of the depth of an operation: element d is the number of times it
+     * visited d nodes (0 on an empty tree).
+     */
+    const std::array<std::size_t, depth_buckets>& depth_histogram(const trace_operation op) const noexcept {
+        return _stats(op).depths;
+    }
+
+    /**
+     * @brief Reset all the counters and histograms to zero.
+     */
+    void reset() noexcept {
+        counting_trace::reset();
+        stats.fill(operation_stats{});
+    }
+};
+
+/**
+ * @brief Shape of a BST, returned by its member function shape_report().
+ */
+struct tree_shape{
+    std::size_t size{0};
+    // number of nodes of the longest path from the root, 0 for an empty tree.
+    std::size_t height{0};
+    // number of nodes without children.
+    std::size_t leaves{0};
+    // mean number of nodes from the root to a node, i.e., the mean cost of a successful lookup.
+    double mean_depth{0};
+    // number of nodes for every balance factor, the height of the left subtree minus the one of the right.
+    std::map<long, std::size_t> balance_factors;
+};
+
+#endif
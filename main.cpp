@@ -10,8 +10,9 @@
 
 int main(){
 
-    using BST = BST<int,int>;
     using PairType = std::pair<const int,int>;
+    // count the events of the tree, to see which node constructors are called.
+    using BST = BST<int,int,std::less<const int>,no_balance,std::allocator<PairType>,counting_trace>;
 
     BST bst{};
     PairType a{8,1};
@@ -28,13 +29,16 @@ int main(){
     std::cout<<"\nInserting pairs into BST...\n\n";
     std::cout<<"Inserting L-value of std::pair<const int, int>. I expect L-value ctor to be called:\n";
     bst.insert(a);
+    std::cout<<to_string(trace_event::lvalue_node_ctor)<<": "<<bst.trace().count(trace_event::lvalue_node_ctor)<<"\n";
     std::cout<<"\n";
     std::cout<<"Inserting R-value of std::pair<const int, int>. I expect R-value ctor to be called.\n";
     bst.insert({3,4});
+    std::cout<<to_string(trace_event::rvalue_node_ctor)<<": "<<bst.trace().count(trace_event::rvalue_node_ctor)<<"\n";
     std::cout<<"\n";
     std::cout<<"Emplacing value into BST.\n";
     bst.emplace(10,55);
     bst.emplace(d);
+    std::cout<<to_string(trace_event::rvalue_node_ctor)<<": "<<bst.trace().count(trace_event::rvalue_node_ctor)<<"\n";
     std::cout<<"\n";
     std::cout<<"Inserting other values...\n";
     bst.insert(e); 
@@ -181,6 +185,23 @@ int main(){
     std::cout<<"After erase:\n";
     std::cout<<"BST1 is: "<<bst<<"BST2 is: "<<bst2<<"\n\n"<<std::endl;
 
+    // testing that the aggregates of a monoid augmentation follow the changes of the values
+    std::cout<<"Changing values of a tree summing its values..."<<std::endl;
+    {
+    ::BST<int,int,std::less<const int>,avl_balance,std::allocator<PairType>,no_trace,monoid_augment<sum_monoid<int>>> sums;
+    for(int i = 0; i < 10; ++i)
+        sums.insert({i,1});
+    sums.insert_or_assign(5,50);
+    sums.update(3,[](int& value){ value = 100; });
+    sums.assign(sums.begin(),7);
+    std::cout<<"aggregate()= "<<sums.aggregate()<<", aggregate(0,10)= "<<sums.aggregate(0,10)<<" (expected 164)\n";
+    if(sums.aggregate() != 164 || sums.aggregate(0,10) != 164){
+        std::cout<<"Stale aggregates!"<<std::endl;
+        return 1;
+    }
+    }
+    std::cout<<std::endl;
+
     
     return 0;
 }
\ No newline at end of file